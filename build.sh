@@ -1,3 +1,4 @@
 #!/bin/sh
 
-clang++ test5.cpp -lrt -O3 -ffast-math -fstrict-aliasing -fno-rtti -fno-exceptions -o bandw
+# extra compiler flags pass through, e.g. ./build.sh -DBANDW_INSTRUMENT=1 for the instrumented build
+clang++ test5.cpp -lrt -pthread -O3 -ffast-math -fstrict-aliasing -fno-rtti -fno-exceptions -o bandw "$@"
@@ -0,0 +1,363 @@
+#ifndef engine_H__
+#define engine_H__
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <arpa/inet.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#include "timer.h"
+#include "pool.h"
+#include "instrument.h"
+
+// I/O engines share a compile-time interface; the transmitter and responder loops are templates
+// over the engine type, so the choice of engine costs nothing in the hot path:
+//
+//   bool init(const engine_config& cfg);
+//     set up the engine atop the bound socket in cfg
+//
+//   size_t tx_acquire(uint8_t** frame, size_t n);
+//     obtain up to n writable frames, prefilled from the template frame; blocks until at least one
+//     is available; returns the number of frames obtained, 0 on error
+//
+//   bool tx_commit(size_t n);
+//     queue the n frames from the last tx_acquire for sending; may kick the kernel
+//
+//   bool tx_flush();
+//     kick the kernel about anything still queued and wait until it has been sent
+//
+//   size_t rx_acquire(const uint8_t** frame, size_t* len, size_t n);
+//     obtain up to n received frames and their lengths; waits, in the poll mode of the config, until
+//     at least one is available or the rx timeout expires; returns the number of frames obtained, 0
+//     on error or timeout, the latter with errno set to EAGAIN
+//
+//   void rx_release();
+//     hand the frames from the last rx_acquire back to the engine
+//
+//   bool rx_reflect(const size_t* index, size_t n);
+//     send the frames index[0..n) of the last rx_acquire, each frame_size long, back out from where
+//     they were received, the caller having rewritten them in place, then release all the frames as
+//     rx_release does; indexes ascending. This drives the tx side too, so no other thread may be
+//     sending on the engine meanwhile
+//
+//   bool tx_timestamp(uint64_t& ns);
+//     fetch the wire-side timestamp of the last frame flushed; false if none is available
+//
+//   bool rx_timestamp(size_t i, uint64_t& ns);
+//     fetch the wire-side timestamp of the i-th frame from the last rx_acquire; false if none is
+//     available
+//
+// Frames obtained from either acquire remain valid until the respective commit or release; rx frames
+// may be written to ahead of an rx_reflect, not otherwise. The tx and rx sides of an engine share no
+// state, so each side may be driven by a thread of its own.
+//
+// Frames are untagged as far as the loops go: ethertype and payload at the offsets of an untagged
+// frame, frame_size long. With 802.1Q tagging configured, the engines send each frame from tag_size
+// octets ahead of it, where every frame they hand out or are given has that much room, with its mac
+// addresses moved up there and the tag in between them and the ethertype, see vlan_insert; incoming
+// frames come untagged regardless, the kernel having taken the outer tag off into the packet
+// metadata, or, where it does not, the engine taking it off in place.
+//
+// Engines report the syscall outcomes of note via probe_event(), see instrument.h.
+
+static const size_t batch_max = 1024; // upper bound on frames per acquire
+
+struct engine_config {
+	int fd;                   // socket, bound to the test iface
+	const sockaddr_ll* saddr; // target socket address
+	uint8_t* frame_tx;        // template outgoing frame, header filled in
+	uint8_t* frame_rx;        // room for one incoming frame
+	frame_pool* pool;         // frame memory of the worker, for the engines keeping frames of their own
+	size_t frame_size;        // size of all outgoing and incoming frames
+	size_t batch;             // frames to queue before kicking the kernel
+	uint32_t queue;           // iface queue, for the engines binding to one
+	int timestamp;            // timestamp source enabled on the socket, see timestamp.h
+	int rx_timeout;           // rx_acquire timeout, ms; -1 for none
+	int poll;                 // rx_poll_mode: how rx_acquire awaits frames
+	size_t tag_size;          // vlan_tag_size to tag outgoing frames, 0 to send them untagged
+	uint16_t tci;             // tag control information of outgoing frames: pcp, dei and vlan id
+	bool sqpoll;              // io_uring engines: a kernel thread takes in the requests, SQPOLL
+	uint32_t local_ip;        // transport engines: ipv4 addresses of the iface and the peer, network
+	uint32_t peer_ip;         // order, 0 if none
+	uint16_t local_port;      // transport engines: ports of the worker at either end
+	uint16_t peer_port;
+	bool initiator;           // tcp engine: connect to the peer rather than await its connection
+	int sndbuf;               // transport engines: socket options asked for, as on the packet socket;
+	int rcvbuf;               // 0 for the default buffer sizes
+	int priority;             // -1 for the default priority
+};
+
+// 802.1Q tag: tag protocol identifier and tag control information
+static const size_t vlan_tag_size = 4;
+static const size_t vlan_mac_size = 2 * ETH_ALEN;
+
+// tag control information of the specified vlan id and priority code point
+static inline uint16_t vlan_tci(
+	const uint32_t id,
+	const uint32_t pcp) {
+
+	return uint16_t(pcp << 13 | id);
+}
+
+// tag a frame, in place: move its mac addresses vlan_tag_size octets ahead, into the room there, and
+// write the tag in between them and the ethertype; the frame then starts vlan_tag_size octets ahead
+static inline void vlan_insert(
+	uint8_t* const frame,
+	const uint16_t tci) {
+
+	const uint16_t tag[2] = { htons(ETH_P_8021Q), htons(tci) };
+
+	memmove(frame - vlan_tag_size, frame, vlan_mac_size);
+	memcpy(frame + vlan_mac_size - vlan_tag_size, tag, sizeof(tag));
+}
+
+// take the tag off a frame, if it carries one, in place: move its mac addresses up over the tag;
+// return the untagged frame, vlan_tag_size octets on, and shorten len accordingly, or the frame as it
+// stands if untagged
+static inline uint8_t* vlan_strip(
+	uint8_t* const frame,
+	size_t& len) {
+
+	uint16_t tpid;
+
+	if (vlan_mac_size + vlan_tag_size > len)
+		return frame;
+
+	memcpy(&tpid, frame + vlan_mac_size, sizeof(tpid));
+
+	if (htons(ETH_P_8021Q) != tpid)
+		return frame;
+
+	memmove(frame + vlan_tag_size, frame, vlan_mac_size);
+	len -= vlan_tag_size;
+	return frame + vlan_tag_size;
+}
+
+// have blocking receives on the socket time out after the specified ms, unless -1; for the engines
+// receiving through the socket calls rather than polling
+static bool set_rx_timeout(
+	const int fd,
+	const int timeout) {
+
+	if (0 > timeout)
+		return true;
+
+	timeval tv;
+	tv.tv_sec = timeout / 1000;
+	tv.tv_usec = timeout % 1000 * 1000;
+
+	if (0 > setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv))) {
+		fprintf(stderr, "error: cannot set rx timeout (errno: %s)\n", strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
+// ways of awaiting incoming frames: sleep in the kernel until frames arrive, spin on non-blocking
+// receives with the socket busy-polling the device, or sleep in epoll_wait
+enum rx_poll_mode {
+	rx_poll_block,
+	rx_poll_busy,
+	rx_poll_epoll,
+
+	rx_poll_mode_count
+};
+
+static const char* const rx_poll_name[rx_poll_mode_count] = {
+	"block",
+	"busy",
+	"epoll"
+};
+
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+
+// busy-poll mode: us the socket calls spin on the device queue for, per call
+static const int busy_poll_us = 50;
+
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+
+#elif defined(__aarch64__)
+	__asm__ __volatile__ ("yield");
+
+#endif
+}
+
+// rx side of an engine awaiting frames in the poll mode of the config; rx_acquire tries to receive,
+// and on finding nothing has the waiter wait, over and over until frames arrive or wait gives up:
+//
+//   uint64_t deadline = 0;
+//
+//   while (nothing received)
+//     if (!waiter.wait(deadline))
+//       return 0;
+//
+// Engines receiving through the socket calls receive with recv_flags(); in block mode those calls
+// block up to the rx timeout themselves, so wait gives up straight away. Engines receiving off a
+// ring have wait poll the socket: up to the rx timeout in block mode, without sleeping in busy mode
+class rx_waiter {
+	int fd;
+	int mode;     // rx_poll_mode
+	int timeout;  // ms; -1 for none
+	bool calls;   // the engine receives through the socket calls
+	short events; // poll events awaited, ring engines
+	int epfd;
+
+	// ms left to the deadline, -1 for none; 0 and errno EAGAIN once the deadline has passed
+	int remaining(uint64_t& deadline) const {
+		if (0 > timeout)
+			return -1;
+
+		const uint64_t now = timer_ns();
+
+		if (0 == deadline)
+			deadline = now + uint64_t(timeout) * 1000000;
+
+		if (now >= deadline) {
+			errno = EAGAIN;
+			return 0;
+		}
+
+		return int((deadline - now + 999999) / 1000000);
+	}
+
+	bool poll_wait(const int ms) const {
+		pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = events;
+		pfd.revents = 0;
+
+		if (0 > ::poll(&pfd, 1, ms) && EINTR != errno) {
+			fprintf(stderr, "error: poll() failed (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		return true;
+	}
+
+public:
+	rx_waiter()
+	: fd(-1)
+	, mode(rx_poll_block)
+	, timeout(-1)
+	, calls(false)
+	, events(0)
+	, epfd(-1) {
+	}
+
+	~rx_waiter() {
+		if (0 <= epfd)
+			close(epfd);
+	}
+
+	bool init(
+		const int sock,          // socket to receive on
+		const engine_config& cfg,
+		const bool socket_calls, // the engine receives through the socket calls rather than off a ring
+		const short poll_events) {
+
+		fd = sock;
+		mode = cfg.poll;
+		timeout = cfg.rx_timeout;
+		calls = socket_calls;
+		events = poll_events;
+
+		switch (mode) {
+		case rx_poll_block:
+			// the socket calls time out by themselves
+			return !calls || set_rx_timeout(fd, timeout);
+
+		case rx_poll_busy: {
+			// busy polling in the kernel is an optional extra, the spinning is done here regardless
+			static bool warned = false;
+			const int prefer = 1;
+
+			if (0 > setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_us, sizeof(busy_poll_us)) && !warned) {
+				fprintf(stderr, "warning: cannot set socket busy poll (errno: %s)\n", strerror(errno));
+				warned = true;
+			}
+
+			if (0 > setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &prefer, sizeof(prefer)) && !warned) {
+				fprintf(stderr, "warning: cannot set socket preferred busy poll (errno: %s)\n", strerror(errno));
+				warned = true;
+			}
+
+			return true;
+		}
+		}
+
+		epfd = epoll_create1(EPOLL_CLOEXEC);
+
+		if (0 > epfd) {
+			fprintf(stderr, "error: cannot create epoll instance (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		epoll_event ev;
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.fd = fd;
+
+		if (0 > epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev)) {
+			fprintf(stderr, "error: cannot add socket to epoll instance (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		return true;
+	}
+
+	// flags for the socket calls to receive with
+	int recv_flags() const {
+		return rx_poll_block == mode ? 0 : MSG_DONTWAIT;
+	}
+
+	// wait for frames after a receive has found none; false if the receive is to give up, on a
+	// timeout with errno set to EAGAIN; deadline is 0 ahead of the first wait of a receive
+	bool wait(uint64_t& deadline) const {
+		if (rx_poll_block == mode && calls) {
+			errno = EAGAIN;
+			return false;
+		}
+
+		const int ms = remaining(deadline);
+
+		if (0 == ms)
+			return false;
+
+		switch (mode) {
+		case rx_poll_block:
+			return poll_wait(ms);
+
+		case rx_poll_busy:
+			// the socket calls spin in the kernel by themselves; a ring is kept going by polling
+			if (calls)
+				cpu_relax();
+			else
+				return poll_wait(0);
+
+			return true;
+		}
+
+		epoll_event ev;
+
+		if (0 > epoll_wait(epfd, &ev, 1, ms) && EINTR != errno) {
+			fprintf(stderr, "error: epoll_wait() failed (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		return true;
+	}
+};
+
+#endif // engine_H__
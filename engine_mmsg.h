@@ -0,0 +1,232 @@
+#ifndef engine_mmsg_H__
+#define engine_mmsg_H__
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include "engine.h"
+#include "timestamp.h"
+
+// batching engine: up to a batch of frames per sendmmsg/recvmmsg, each frame in a frame pool slot of its own
+class engine_mmsg {
+	int fd;
+	size_t frame_size;
+	size_t tag_size;
+	uint16_t tci;
+	size_t batch;
+	int timestamp;
+
+	uint8_t* buffer; // batch tx frames followed by batch rx frames, from the pool
+	size_t stride;   // distance of one frame from the next in the buffer
+	mmsghdr* msg;    // batch tx headers, batch rx headers, then batch reflect headers
+	iovec* iov;      // batch tx vectors, batch rx vectors, then batch reflect vectors, the latter
+	                 // of the rx frames as they go back out
+	uint8_t* control; // batch rx control buffers, when timestamping
+
+	size_t tx_acquired;
+
+	rx_waiter waiter;
+
+	// send the n frames of the specified headers, all of them
+	bool send(mmsghdr* const m, const size_t n) {
+		for (size_t i = 0; i < n;) {
+			const int sent = sendmmsg(fd, m + i, n - i, 0);
+
+			if (0 > sent) {
+				if (EINTR == errno)
+					continue;
+
+				fprintf(stderr, "error: sendmmsg() failed (errno: %s)\n", strerror(errno));
+				return false;
+			}
+
+			for (int j = 0; j < sent; ++j) {
+				if (frame_size + tag_size != m[i + j].msg_len) {
+					fprintf(stderr, "error: sendmmsg() failed to send requested byte count\n");
+					return false;
+				}
+			}
+
+			if (sent < int(n - i))
+				probe_event(probe_short_write);
+
+			i += sent;
+		}
+
+		return true;
+	}
+
+public:
+	engine_mmsg()
+	: fd(-1)
+	, frame_size(0)
+	, tag_size(0)
+	, tci(0)
+	, batch(0)
+	, timestamp(timestamp_none)
+	, buffer(0)
+	, stride(0)
+	, msg(0)
+	, iov(0)
+	, control(0)
+	, tx_acquired(0) {
+	}
+
+	~engine_mmsg() {
+		free(msg);
+		free(iov);
+		free(control);
+	}
+
+	bool init(const engine_config& cfg) {
+		fd = cfg.fd;
+		frame_size = cfg.frame_size;
+		tag_size = cfg.tag_size;
+		tci = cfg.tci;
+		batch = cfg.batch;
+		timestamp = cfg.timestamp;
+
+		if (!waiter.init(fd, cfg, true, POLLIN))
+			return false;
+
+		buffer = cfg.pool->take(batch * 2);
+		stride = cfg.pool->stride();
+		msg = reinterpret_cast< mmsghdr* >(calloc(batch * 3, sizeof(mmsghdr)));
+		iov = reinterpret_cast< iovec* >(calloc(batch * 3, sizeof(iovec)));
+
+		if (0 == buffer || 0 == msg || 0 == iov) {
+			fprintf(stderr, "error: cannot allocate batch buffers\n");
+			return false;
+		}
+
+		if (timestamp_none != timestamp) {
+			control = reinterpret_cast< uint8_t* >(malloc(timestamp_control_size * batch));
+
+			if (0 == control) {
+				fprintf(stderr, "error: cannot allocate batch buffers\n");
+				return false;
+			}
+		}
+
+		// frames sit tag_size octets into their slots, with room for the tag ahead of them
+		for (size_t i = 0; i < batch * 2; ++i) {
+			iov[i].iov_base = buffer + i * stride + tag_size;
+			iov[i].iov_len = frame_size;
+			msg[i].msg_hdr.msg_iov = iov + i;
+			msg[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		// tx frames are prefilled from the template, tagged if tagging, and addressed to the target
+		for (size_t i = 0; i < batch; ++i) {
+			memcpy(buffer + i * stride, cfg.frame_tx - tag_size, frame_size + tag_size);
+			iov[i].iov_base = buffer + i * stride;
+			iov[i].iov_len = frame_size + tag_size;
+			msg[i].msg_hdr.msg_name = const_cast< sockaddr_ll* >(cfg.saddr);
+			msg[i].msg_hdr.msg_namelen = sizeof(*cfg.saddr);
+		}
+
+		// reflect headers get pointed at the reflect vectors of the frames sent back, on each rx_reflect
+		for (size_t i = batch * 2; i < batch * 3; ++i) {
+			iov[i].iov_base = buffer + (i - batch) * stride;
+			iov[i].iov_len = frame_size + tag_size;
+			msg[i].msg_hdr.msg_iovlen = 1;
+			msg[i].msg_hdr.msg_name = const_cast< sockaddr_ll* >(cfg.saddr);
+			msg[i].msg_hdr.msg_namelen = sizeof(*cfg.saddr);
+		}
+
+		return true;
+	}
+
+	size_t tx_acquire(uint8_t** frame, const size_t n) {
+		const size_t count = n < batch ? n : batch;
+
+		for (size_t i = 0; i < count; ++i)
+			frame[i] = reinterpret_cast< uint8_t* >(iov[i].iov_base) + tag_size;
+
+		tx_acquired = count;
+		return count;
+	}
+
+	bool tx_commit(const size_t n) {
+		assert(n <= tx_acquired);
+
+		if (!send(msg, n))
+			return false;
+
+		tx_acquired = 0;
+		return true;
+	}
+
+	bool tx_flush() {
+		return true;
+	}
+
+	size_t rx_acquire(const uint8_t** frame, size_t* len, const size_t n) {
+		mmsghdr* const rx_msg = msg + batch;
+		const size_t count = n < batch ? n : batch;
+		int recv;
+
+		// recvmmsg trims the control lengths to what was received, so restore them on every call
+		if (0 != control) {
+			for (size_t i = 0; i < count; ++i) {
+				rx_msg[i].msg_hdr.msg_control = control + i * timestamp_control_size;
+				rx_msg[i].msg_hdr.msg_controllen = timestamp_control_size;
+			}
+		}
+
+		for (uint64_t deadline = 0;;) {
+			do
+				recv = recvmmsg(fd, rx_msg, count, MSG_WAITFORONE | waiter.recv_flags(), 0);
+			while (0 > recv && EINTR == errno);
+
+			if (0 < recv)
+				break;
+
+			if (EAGAIN != errno && EWOULDBLOCK != errno) {
+				fprintf(stderr, "error: recvmmsg() failed (errno: %s)\n", strerror(errno));
+				return 0;
+			}
+
+			if (!waiter.wait(deadline))
+				return 0;
+		}
+
+		for (int i = 0; i < recv; ++i) {
+			frame[i] = reinterpret_cast< const uint8_t* >(rx_msg[i].msg_hdr.msg_iov->iov_base);
+			len[i] = rx_msg[i].msg_len;
+		}
+
+		return size_t(recv);
+	}
+
+	void rx_release() {
+	}
+
+	bool rx_reflect(const size_t* index, const size_t n) {
+		iovec* const rx_iov = iov + batch;
+		iovec* const reflect_iov = iov + batch * 2;
+		mmsghdr* const reflect_msg = msg + batch * 2;
+
+		for (size_t i = 0; i < n; ++i) {
+			if (0 != tag_size)
+				vlan_insert(reinterpret_cast< uint8_t* >(rx_iov[index[i]].iov_base), tci);
+
+			reflect_msg[i].msg_hdr.msg_iov = reflect_iov + index[i];
+		}
+
+		return send(reflect_msg, n);
+	}
+
+	bool tx_timestamp(uint64_t& ns) {
+		return timestamp_none != timestamp && errqueue_timestamp(fd, timestamp, ns, timestamp_wait_ms);
+	}
+
+	bool rx_timestamp(const size_t i, uint64_t& ns) {
+		return 0 != control && cmsg_timestamp(msg[batch + i].msg_hdr, timestamp, ns);
+	}
+};
+
+#endif // engine_mmsg_H__
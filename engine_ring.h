@@ -0,0 +1,385 @@
+#ifndef engine_ring_H__
+#define engine_ring_H__
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include "engine.h"
+#include "timestamp.h"
+
+// memory-mapped engine: TPACKET_V3 rx and tx rings on the packet socket; outgoing frames are
+// written straight into the tx ring and the kernel is kicked once per batch, incoming frames are
+// read in place from the rx ring blocks
+class engine_ring {
+	enum {
+		rx_block_size = 1 << 20, // rx block, octets; a multiple of the page size
+		rx_block_nr   = 16,      // rx blocks in the ring
+		rx_block_tov  = 1,       // rx block retire timeout, ms
+		tx_block_size = 1 << 20, // tx block, octets; a multiple of the page size
+		tx_block_nr   = 8        // tx blocks in the ring
+	};
+
+	int fd;
+	const sockaddr_ll* saddr;
+	size_t frame_size;
+	size_t tag_size;
+	uint16_t tci;
+	size_t batch;
+	int timestamp;
+
+	uint8_t* map;
+	size_t map_size;
+
+	// rx ring state: current block, next packet in it and packets left therein
+	uint8_t* rx_base;
+	size_t rx_block;
+	const tpacket3_hdr* rx_next;
+	size_t rx_left;
+
+	// headers of the frames from the last rx_acquire, for their timestamps
+	const tpacket3_hdr* rx_acquired[batch_max];
+
+	rx_waiter waiter;
+
+	// tx ring state: slot geometry, next slot to acquire, frames acquired and frames yet to kick
+	uint8_t* tx_base;
+	size_t tx_slot_size;
+	size_t tx_slots_per_block;
+	size_t tx_slot_nr;
+	size_t tx_head;
+	size_t tx_acquired;
+	size_t tx_pending;
+	size_t tx_last;
+
+	static size_t tpacket_align(const size_t x) {
+		return (x + TPACKET_ALIGNMENT - 1) & ~size_t(TPACKET_ALIGNMENT - 1);
+	}
+
+	// offset of frame data from the start of a tx slot
+	static size_t tx_data_offset() {
+		return TPACKET3_HDRLEN - sizeof(sockaddr_ll);
+	}
+
+	tpacket3_hdr* tx_slot(const size_t i) const {
+		return reinterpret_cast< tpacket3_hdr* >(tx_base +
+			i / tx_slots_per_block * size_t(tx_block_size) +
+			i % tx_slots_per_block * tx_slot_size);
+	}
+
+	tpacket_block_desc* rx_desc(const size_t i) const {
+		return reinterpret_cast< tpacket_block_desc* >(rx_base + i * size_t(rx_block_size));
+	}
+
+	// timestamp of a ring frame, if the kernel has put one there
+	static bool slot_timestamp(const tpacket3_hdr* const hdr, uint64_t& ns) {
+		const uint32_t status = __atomic_load_n(&hdr->tp_status, __ATOMIC_ACQUIRE);
+
+		if (0 == (status & (TP_STATUS_TS_SOFTWARE | TP_STATUS_TS_RAW_HARDWARE)))
+			return false;
+
+		ns = 1000000000ULL * hdr->tp_sec + hdr->tp_nsec;
+		return true;
+	}
+
+	// wait for the socket to signal the specified events, up to timeout ms, or indefinitely if -1
+	bool wait(const short events, const int timeout) const {
+		pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = events;
+		pfd.revents = 0;
+
+		const int res = poll(&pfd, 1, timeout);
+
+		// a timeout is no error, but the caller has to give up all the same
+		if (0 == res) {
+			errno = EAGAIN;
+			return false;
+		}
+
+		if (0 > res && EINTR != errno) {
+			fprintf(stderr, "error: poll() failed (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		return true;
+	}
+
+	// have the kernel send all tx frames requested so far; optionally wait for that to complete
+	bool kick(const bool wait_completion) {
+		const int flags = wait_completion ? 0 : MSG_DONTWAIT;
+
+		for (;;) {
+			if (0 <= sendto(fd, 0, 0, flags, reinterpret_cast< const sockaddr* >(saddr), sizeof(*saddr)))
+				break;
+
+			// a full device queue leaves the frames requested for the next kick
+			if (EAGAIN == errno || ENOBUFS == errno) {
+				probe_event(probe_tx_busy);
+
+				if (wait_completion)
+					continue;
+				break;
+			}
+
+			if (EINTR == errno)
+				continue;
+
+			fprintf(stderr, "error: sendto() failed to kick tx ring (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		tx_pending = 0;
+		return true;
+	}
+
+public:
+	engine_ring()
+	: fd(-1)
+	, saddr(0)
+	, frame_size(0)
+	, tag_size(0)
+	, tci(0)
+	, batch(0)
+	, timestamp(timestamp_none)
+	, map(reinterpret_cast< uint8_t* >(MAP_FAILED))
+	, map_size(0)
+	, rx_base(0)
+	, rx_block(0)
+	, rx_next(0)
+	, rx_left(0)
+	, tx_base(0)
+	, tx_slot_size(0)
+	, tx_slots_per_block(0)
+	, tx_slot_nr(0)
+	, tx_head(0)
+	, tx_acquired(0)
+	, tx_pending(0)
+	, tx_last(0) {
+	}
+
+	~engine_ring() {
+		if (MAP_FAILED != map)
+			munmap(map, map_size);
+	}
+
+	bool init(const engine_config& cfg) {
+		fd = cfg.fd;
+		saddr = cfg.saddr;
+		frame_size = cfg.frame_size;
+		tag_size = cfg.tag_size;
+		tci = cfg.tci;
+		batch = cfg.batch;
+		timestamp = cfg.timestamp;
+
+		const int version = TPACKET_V3;
+
+		if (0 > setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version))) {
+			fprintf(stderr, "error: cannot set TPACKET_V3 (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		// the rings carry their timestamps in the frame headers; ask for those from the NIC clock if so
+		// configured, the kernel stamps frames in software otherwise
+		if (timestamp_hw == timestamp) {
+			const int req = SOF_TIMESTAMPING_RAW_HARDWARE;
+
+			if (0 > setsockopt(fd, SOL_PACKET, PACKET_TIMESTAMP, &req, sizeof(req))) {
+				fprintf(stderr, "error: cannot set ring timestamp source (errno: %s)\n", strerror(errno));
+				return false;
+			}
+		}
+
+		tx_slot_size = tpacket_align(tx_data_offset() + tag_size + frame_size);
+		tx_slots_per_block = size_t(tx_block_size) / tx_slot_size;
+		tx_slot_nr = tx_slots_per_block * size_t(tx_block_nr);
+
+		if (0 == tx_slots_per_block) {
+			fprintf(stderr, "error: frame size exceeds tx ring block\n");
+			return false;
+		}
+
+		tpacket_req3 rx_req;
+		memset(&rx_req, 0, sizeof(rx_req));
+		rx_req.tp_block_size = rx_block_size;
+		rx_req.tp_block_nr = rx_block_nr;
+		rx_req.tp_frame_size = tx_slot_size;
+		rx_req.tp_frame_nr = size_t(rx_block_size) / tx_slot_size * size_t(rx_block_nr);
+		rx_req.tp_retire_blk_tov = rx_block_tov;
+
+		if (0 > setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &rx_req, sizeof(rx_req))) {
+			fprintf(stderr, "error: cannot set up rx ring (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		tpacket_req3 tx_req;
+		memset(&tx_req, 0, sizeof(tx_req));
+		tx_req.tp_block_size = tx_block_size;
+		tx_req.tp_block_nr = tx_block_nr;
+		tx_req.tp_frame_size = tx_slot_size;
+		tx_req.tp_frame_nr = tx_slot_nr;
+
+		if (0 > setsockopt(fd, SOL_PACKET, PACKET_TX_RING, &tx_req, sizeof(tx_req))) {
+			fprintf(stderr, "error: cannot set up tx ring (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		// rx ring comes first in the mapping, tx ring follows
+		const size_t rx_size = size_t(rx_block_size) * size_t(rx_block_nr);
+		const size_t tx_size = size_t(tx_block_size) * size_t(tx_block_nr);
+
+		map_size = rx_size + tx_size;
+		map = reinterpret_cast< uint8_t* >(mmap(0, map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0));
+
+		if (MAP_FAILED == map) {
+			fprintf(stderr, "error: cannot map rings (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		rx_base = map;
+		tx_base = map + rx_size;
+
+		// prefill all tx slots from the template frame, tagged if tagging
+		for (size_t i = 0; i < tx_slot_nr; ++i)
+			memcpy(reinterpret_cast< uint8_t* >(tx_slot(i)) + tx_data_offset(), cfg.frame_tx - tag_size, frame_size + tag_size);
+
+		return waiter.init(fd, cfg, false, POLLIN | POLLERR);
+	}
+
+	size_t tx_acquire(uint8_t** frame, const size_t n) {
+		size_t count = 0;
+
+		while (0 == count) {
+			for (; count < n && count < tx_slot_nr; ++count) {
+				tpacket3_hdr* const hdr = tx_slot((tx_head + count) % tx_slot_nr);
+				const uint32_t status = __atomic_load_n(&hdr->tp_status, __ATOMIC_ACQUIRE);
+
+				if (TP_STATUS_WRONG_FORMAT & status) {
+					fprintf(stderr, "error: tx ring frame rejected by kernel\n");
+					return 0;
+				}
+
+				// a sent frame may come back flagged with the source of its timestamp
+				if (0 != (status & (TP_STATUS_SEND_REQUEST | TP_STATUS_SENDING)))
+					break;
+
+				frame[count] = reinterpret_cast< uint8_t* >(hdr) + tx_data_offset() + tag_size;
+			}
+
+			// ring full - make sure the kernel is draining it and wait for a slot
+			if (0 == count && (!kick(false) || !wait(POLLOUT, -1)))
+				return 0;
+		}
+
+		tx_acquired = count;
+		return count;
+	}
+
+	bool tx_commit(const size_t n) {
+		assert(n <= tx_acquired);
+
+		for (size_t i = 0; i < n; ++i) {
+			tpacket3_hdr* const hdr = tx_slot((tx_head + i) % tx_slot_nr);
+			hdr->tp_len = frame_size + tag_size;
+			__atomic_store_n(&hdr->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+		}
+
+		tx_last = (tx_head + n - 1) % tx_slot_nr;
+		tx_head = (tx_head + n) % tx_slot_nr;
+		tx_acquired = 0;
+		tx_pending += n;
+
+		if (tx_pending >= batch)
+			return kick(false);
+
+		return true;
+	}
+
+	bool tx_flush() {
+		return kick(true);
+	}
+
+	size_t rx_acquire(const uint8_t** frame, size_t* len, const size_t n) {
+		uint64_t deadline = 0;
+
+		while (0 == rx_left) {
+			tpacket_block_desc* const desc = rx_desc(rx_block);
+
+			if (0 == (TP_STATUS_USER & __atomic_load_n(&desc->hdr.bh1.block_status, __ATOMIC_ACQUIRE))) {
+				if (!waiter.wait(deadline))
+					return 0;
+				continue;
+			}
+
+			rx_left = desc->hdr.bh1.num_pkts;
+			rx_next = reinterpret_cast< const tpacket3_hdr* >(reinterpret_cast< uint8_t* >(desc) + desc->hdr.bh1.offset_to_first_pkt);
+
+			// nothing in this block - hand it straight back
+			if (0 == rx_left) {
+				__atomic_store_n(&desc->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+				rx_block = (rx_block + 1) % size_t(rx_block_nr);
+			}
+		}
+
+		size_t count = 0;
+
+		for (; count < n && 0 != rx_left; ++count, --rx_left) {
+			rx_acquired[count] = rx_next;
+			frame[count] = reinterpret_cast< const uint8_t* >(rx_next) + rx_next->tp_mac;
+			len[count] = rx_next->tp_snaplen;
+			rx_next = reinterpret_cast< const tpacket3_hdr* >(reinterpret_cast< const uint8_t* >(rx_next) + rx_next->tp_next_offset);
+		}
+
+		return count;
+	}
+
+	void rx_release() {
+		// block exhausted - return it to the kernel
+		if (0 == rx_left && 0 != rx_next) {
+			__atomic_store_n(&rx_desc(rx_block)->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+			rx_block = (rx_block + 1) % size_t(rx_block_nr);
+			rx_next = 0;
+		}
+	}
+
+	// the rings share no memory, so frames sent back get copied from the rx ring into tx slots;
+	// they go out with a kick per call
+	bool rx_reflect(const size_t* index, const size_t n) {
+		for (size_t i = 0; i < n;) {
+			uint8_t* frame[batch_max];
+			const size_t count = tx_acquire(frame, n - i);
+
+			if (0 == count)
+				return false;
+
+			for (size_t j = 0; j < count; ++j, ++i) {
+				const tpacket3_hdr* const hdr = rx_acquired[index[i]];
+				memcpy(frame[j], reinterpret_cast< const uint8_t* >(hdr) + hdr->tp_mac, frame_size);
+
+				if (0 != tag_size)
+					vlan_insert(frame[j], tci);
+			}
+
+			if (!tx_commit(count))
+				return false;
+		}
+
+		rx_release();
+		return 0 == tx_pending || kick(false);
+	}
+
+	bool tx_timestamp(uint64_t& ns) {
+		// hardware timestamps land in the slot, software ones on the error queue
+		return timestamp_none != timestamp &&
+			(slot_timestamp(tx_slot(tx_last), ns) || errqueue_timestamp(fd, timestamp, ns, timestamp_wait_ms));
+	}
+
+	bool rx_timestamp(const size_t i, uint64_t& ns) {
+		return timestamp_none != timestamp && slot_timestamp(rx_acquired[i], ns);
+	}
+};
+
+#endif // engine_ring_H__
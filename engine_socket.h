@@ -0,0 +1,150 @@
+#ifndef engine_socket_H__
+#define engine_socket_H__
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include "engine.h"
+#include "timestamp.h"
+
+// baseline engine: one sendto/recvfrom per frame, straight from/to the frames supplied by the config
+class engine_socket {
+	int fd;
+	const sockaddr_ll* saddr;
+	uint8_t* frame_tx;
+	uint8_t* frame_rx;
+	size_t frame_size;
+	size_t tag_size;
+	uint16_t tci;
+	int timestamp;
+
+	// rx control messages and the timestamp they carried, when timestamping
+	uint64_t control[timestamp_control_size / sizeof(uint64_t)];
+	uint64_t rx_ts;
+	bool rx_ts_valid;
+
+	rx_waiter waiter;
+
+	// receive a frame into frame_rx, along with its timestamp when timestamping
+	ssize_t receive() {
+		if (timestamp_none == timestamp)
+			return recvfrom(fd, frame_rx, frame_size, waiter.recv_flags(), 0, 0);
+
+		iovec iov;
+		iov.iov_base = frame_rx;
+		iov.iov_len = frame_size;
+
+		msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+
+		const ssize_t recv = recvmsg(fd, &msg, waiter.recv_flags());
+		rx_ts_valid = 0 <= recv && cmsg_timestamp(msg, timestamp, rx_ts);
+		return recv;
+	}
+
+public:
+	engine_socket()
+	: fd(-1)
+	, saddr(0)
+	, frame_tx(0)
+	, frame_rx(0)
+	, frame_size(0)
+	, tag_size(0)
+	, tci(0)
+	, timestamp(timestamp_none)
+	, rx_ts(0)
+	, rx_ts_valid(false) {
+	}
+
+	bool init(const engine_config& cfg) {
+		fd = cfg.fd;
+		saddr = cfg.saddr;
+		frame_tx = cfg.frame_tx;
+		frame_rx = cfg.frame_rx;
+		frame_size = cfg.frame_size;
+		tag_size = cfg.tag_size;
+		tci = cfg.tci;
+		timestamp = cfg.timestamp;
+
+		return waiter.init(fd, cfg, true, POLLIN);
+	}
+
+	size_t tx_acquire(uint8_t** frame, const size_t) {
+		frame[0] = frame_tx;
+		return 1;
+	}
+
+	// the template frame comes tagged, if tagging
+	bool tx_commit(const size_t) {
+		const ssize_t sent = sendto(fd, frame_tx - tag_size, frame_size + tag_size, 0, reinterpret_cast< const sockaddr* >(saddr), sizeof(*saddr));
+
+		if (ssize_t(frame_size + tag_size) != sent) {
+			probe_event(probe_short_write);
+			fprintf(stderr, "error: sendto() failed to send requested byte count (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		return true;
+	}
+
+	bool tx_flush() {
+		return true;
+	}
+
+	size_t rx_acquire(const uint8_t** frame, size_t* len, const size_t) {
+		for (uint64_t deadline = 0;;) {
+			const ssize_t recv = receive();
+
+			if (0 <= recv) {
+				frame[0] = frame_rx;
+				len[0] = size_t(recv);
+				return 1;
+			}
+
+			if (EAGAIN != errno && EWOULDBLOCK != errno) {
+				fprintf(stderr, "error: recvfrom() failed (errno: %s)\n", strerror(errno));
+				return 0;
+			}
+
+			if (!waiter.wait(deadline))
+				return 0;
+		}
+	}
+
+	void rx_release() {
+	}
+
+	bool rx_reflect(const size_t*, const size_t n) {
+		if (0 == n)
+			return true;
+
+		if (0 != tag_size)
+			vlan_insert(frame_rx, tci);
+
+		const ssize_t sent = sendto(fd, frame_rx - tag_size, frame_size + tag_size, 0, reinterpret_cast< const sockaddr* >(saddr), sizeof(*saddr));
+
+		if (ssize_t(frame_size + tag_size) != sent) {
+			probe_event(probe_short_write);
+			fprintf(stderr, "error: sendto() failed to send requested byte count (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		return true;
+	}
+
+	bool tx_timestamp(uint64_t& ns) {
+		return timestamp_none != timestamp && errqueue_timestamp(fd, timestamp, ns, timestamp_wait_ms);
+	}
+
+	bool rx_timestamp(const size_t, uint64_t& ns) {
+		ns = rx_ts;
+		return rx_ts_valid;
+	}
+};
+
+#endif // engine_socket_H__
@@ -0,0 +1,388 @@
+#ifndef engine_tcp_H__
+#define engine_tcp_H__
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "engine.h"
+#include "transport.h"
+
+// transport engine: the frames as fixed-size records of a tcp stream per worker, the transmitter
+// connecting to the responder's port of the worker; a batch of records per sendmsg, and as many as
+// have arrived, up to the rx frames, per recvmsg, a record cut short by the receive carried over to
+// the next. The stream takes no loss, the sender waiting on the receiver's window instead, which is
+// what there is to compare
+class engine_tcp {
+	enum {
+		rx_slots_min = 64 // rx frames a receive takes at least, whatever the batch
+	};
+
+	int fd;
+	size_t frame_size;
+	size_t payload;    // octets per record: the frame past its eth header
+	size_t batch;
+	size_t rx_slots;   // frames a receive takes at most
+	int rx_timeout;
+	bool eof;          // the peer has closed its end
+	bool broken;       // the peer has gone, sends go nowhere
+
+	uint8_t* buffer;   // batch tx frames followed by rx_slots rx frames, mapped apart from the pool
+	size_t buffer_size;
+	size_t stride;
+	iovec* iov;        // payloads of the batch tx frames, the rx frames, the rx frames as they go
+	                   // back out, then rx_slots vectors of a send cut short
+	size_t rx_count;   // complete records of the last receive
+	size_t rx_next;    // of those, the first not yet handed out
+	size_t rx_first;   // first frame of the last rx_acquire
+	size_t rx_partial; // octets of a record cut short, past the complete ones
+
+	rx_waiter waiter;
+
+	uint8_t* frame_of(const size_t i) const {
+		return buffer + i * stride;
+	}
+
+	// have the stream set up: the transmitter connects to the peer's port, retrying while the peer
+	// sets up; the responder awaits the connection from the peer on its own port
+	bool connect_stream(const engine_config& cfg) {
+		const sockaddr_in peer = transport_addr(cfg.peer_ip, cfg.peer_port);
+		const uint64_t deadline = timer_ns() + uint64_t(transport_connect_ms + rx_timeout) * 1000000;
+
+		if (cfg.initiator) {
+			for (;;) {
+				// the port of the worker at this end is of no consequence; an ephemeral one it is,
+				// clear of the connection of the run before
+				fd = transport_socket(cfg, SOCK_STREAM, 0, "tcp");
+
+				if (0 > fd)
+					return false;
+
+				if (0 == connect(fd, reinterpret_cast< const sockaddr* >(&peer), sizeof(peer)))
+					return true;
+
+				const int err = errno;
+				close(fd);
+				fd = -1;
+
+				if ((ECONNREFUSED != err && EINTR != err) || timer_ns() >= deadline) {
+					fprintf(stderr, "error: cannot connect to tcp port %u of the peer (errno: %s)\n", unsigned(cfg.peer_port), strerror(err));
+					return false;
+				}
+
+				usleep(10000);
+			}
+		}
+
+		const int lfd = transport_socket(cfg, SOCK_STREAM, cfg.local_port, "tcp");
+
+		if (0 > lfd)
+			return false;
+
+		if (0 > listen(lfd, 1)) {
+			fprintf(stderr, "error: cannot listen on tcp port %u (errno: %s)\n", unsigned(cfg.local_port), strerror(errno));
+			close(lfd);
+			return false;
+		}
+
+		// connections from anyone but the peer get turned away
+		while (0 > fd) {
+			const uint64_t now = timer_ns();
+			pollfd pfd;
+			pfd.fd = lfd;
+			pfd.events = POLLIN;
+			pfd.revents = 0;
+
+			const int res = now < deadline ? poll(&pfd, 1, int((deadline - now) / 1000000) + 1) : 0;
+
+			if (0 > res && EINTR == errno)
+				continue;
+
+			if (0 >= res) {
+				fprintf(stderr, "error: no tcp connection from the peer on port %u\n", unsigned(cfg.local_port));
+				close(lfd);
+				return false;
+			}
+
+			sockaddr_in from;
+			socklen_t fromlen = sizeof(from);
+			const int s = accept4(lfd, reinterpret_cast< sockaddr* >(&from), &fromlen, SOCK_CLOEXEC);
+
+			if (0 > s)
+				continue;
+
+			if (from.sin_addr.s_addr == cfg.peer_ip)
+				fd = s;
+			else
+				close(s);
+		}
+
+		close(lfd);
+		return true;
+	}
+
+	// send the records of the n payloads, all of them
+	bool send(const iovec* const v, const size_t n) {
+		if (broken)
+			return true;
+
+		iovec* const partial = iov + batch + rx_slots * 2;
+		msghdr m;
+		memset(&m, 0, sizeof(m));
+		m.msg_iov = const_cast< iovec* >(v);
+		m.msg_iovlen = n;
+		bool copied = false;
+
+		for (size_t left = n * payload; 0 != left;) {
+			const ssize_t sent = sendmsg(fd, &m, MSG_NOSIGNAL);
+
+			if (0 > sent) {
+				if (EINTR == errno)
+					continue;
+
+				// the peer is done with the run; what has not gone out is lost, as it would be on the wire
+				if (EPIPE == errno || ECONNRESET == errno) {
+					broken = true;
+					return true;
+				}
+
+				fprintf(stderr, "error: sendmsg() failed (errno: %s)\n", strerror(errno));
+				return false;
+			}
+
+			left -= size_t(sent);
+
+			if (0 == left)
+				break;
+
+			probe_event(probe_short_write);
+
+			// go on from where the stack left off, in a copy of the vectors
+			if (!copied) {
+				memcpy(partial, m.msg_iov, m.msg_iovlen * sizeof(iovec));
+				m.msg_iov = partial;
+				copied = true;
+			}
+
+			size_t skip = size_t(sent);
+
+			while (skip >= m.msg_iov[0].iov_len) {
+				skip -= m.msg_iov[0].iov_len;
+				++m.msg_iov;
+				--m.msg_iovlen;
+			}
+
+			m.msg_iov[0].iov_base = reinterpret_cast< uint8_t* >(m.msg_iov[0].iov_base) + skip;
+			m.msg_iov[0].iov_len -= skip;
+		}
+
+		return true;
+	}
+
+public:
+	engine_tcp()
+	: fd(-1)
+	, frame_size(0)
+	, payload(0)
+	, batch(0)
+	, rx_slots(0)
+	, rx_timeout(-1)
+	, eof(false)
+	, broken(false)
+	, buffer(0)
+	, buffer_size(0)
+	, stride(0)
+	, iov(0)
+	, rx_count(0)
+	, rx_next(0)
+	, rx_first(0)
+	, rx_partial(0) {
+	}
+
+	~engine_tcp() {
+		if (0 <= fd)
+			close(fd);
+
+		if (0 != buffer)
+			munmap(buffer, buffer_size);
+
+		free(iov);
+	}
+
+	bool init(const engine_config& cfg) {
+		frame_size = cfg.frame_size;
+		payload = frame_size - ETH_HLEN;
+		batch = cfg.batch;
+		rx_slots = batch < rx_slots_min ? size_t(rx_slots_min) : batch;
+		rx_timeout = cfg.rx_timeout;
+
+		if (0 != cfg.tag_size) {
+			fprintf(stderr, "error: tcp engine: frames go via the ip stack untagged; tag them by a vlan iface instead\n");
+			return false;
+		}
+
+		if (!connect_stream(cfg))
+			return false;
+
+		// records go out as they come, paced or ping-pong ones included
+		const int on = 1;
+
+		if (0 > setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on))) {
+			fprintf(stderr, "error: cannot set tcp nodelay (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		if (!waiter.init(fd, cfg, true, POLLIN))
+			return false;
+
+		stride = cfg.pool->stride();
+		buffer_size = (batch + rx_slots) * stride;
+		buffer = cfg.pool->map(buffer_size);
+		iov = reinterpret_cast< iovec* >(calloc(batch + rx_slots * 3, sizeof(iovec)));
+
+		if (0 == buffer || 0 == iov) {
+			fprintf(stderr, "error: cannot allocate batch buffers\n");
+			return false;
+		}
+
+		// tx frames are prefilled from the template; only their payloads go out
+		for (size_t i = 0; i < batch; ++i) {
+			memcpy(frame_of(i), cfg.frame_tx, frame_size);
+			iov[i].iov_base = frame_of(i) + ETH_HLEN;
+			iov[i].iov_len = payload;
+		}
+
+		// rx frames get the eth header of frames from the peer once, the records landing past it
+		for (size_t i = 0; i < rx_slots; ++i) {
+			transport_rx_header(cfg, frame_of(batch + i));
+			iov[batch + i].iov_base = frame_of(batch + i) + ETH_HLEN;
+			iov[batch + i].iov_len = payload;
+		}
+
+		return true;
+	}
+
+	size_t tx_acquire(uint8_t** frame, const size_t n) {
+		const size_t count = n < batch ? n : batch;
+
+		for (size_t i = 0; i < count; ++i)
+			frame[i] = frame_of(i);
+
+		return count;
+	}
+
+	bool tx_commit(const size_t n) {
+		assert(n <= batch);
+		return send(iov, n);
+	}
+
+	bool tx_flush() {
+		return true;
+	}
+
+	size_t rx_acquire(const uint8_t** frame, size_t* len, const size_t n) {
+		iovec* const rx_iov = iov + batch;
+
+		// records left over from a receive go first
+		if (rx_next == rx_count) {
+			// the record cut short moves up to the first rx frame, for the rest of it to follow
+			if (0 != rx_partial && 0 != rx_count)
+				memmove(rx_iov[0].iov_base, rx_iov[rx_count].iov_base, rx_partial);
+
+			rx_count = 0;
+			rx_next = 0;
+
+			for (uint64_t deadline = 0; 0 == rx_count;) {
+				// the peer is done: no more records, which the loops learn the way they would of a
+				// stream gone quiet, after the rx timeout
+				if (eof) {
+					poll(0, 0, rx_timeout);
+					errno = EAGAIN;
+					return 0;
+				}
+
+				rx_iov[0].iov_base = frame_of(batch) + ETH_HLEN + rx_partial;
+				rx_iov[0].iov_len = payload - rx_partial;
+
+				msghdr m;
+				memset(&m, 0, sizeof(m));
+				m.msg_iov = rx_iov;
+				m.msg_iovlen = rx_slots;
+
+				const ssize_t recv = recvmsg(fd, &m, waiter.recv_flags());
+
+				rx_iov[0].iov_base = frame_of(batch) + ETH_HLEN;
+				rx_iov[0].iov_len = payload;
+
+				if (0 > recv) {
+					if (EINTR == errno)
+						continue;
+
+					if (ECONNRESET == errno) {
+						eof = true;
+						continue;
+					}
+
+					if (EAGAIN != errno && EWOULDBLOCK != errno) {
+						fprintf(stderr, "error: recvmsg() failed (errno: %s)\n", strerror(errno));
+						return 0;
+					}
+
+					if (!waiter.wait(deadline))
+						return 0;
+
+					continue;
+				}
+
+				if (0 == recv) {
+					eof = true;
+					continue;
+				}
+
+				const size_t total = rx_partial + size_t(recv);
+				rx_count = total / payload;
+				rx_partial = total % payload;
+			}
+		}
+
+		const size_t count = n < rx_count - rx_next ? n : rx_count - rx_next;
+
+		for (size_t i = 0; i < count; ++i) {
+			frame[i] = frame_of(batch + rx_next + i);
+			len[i] = frame_size;
+		}
+
+		rx_first = rx_next;
+		rx_next += count;
+		return count;
+	}
+
+	void rx_release() {
+	}
+
+	bool rx_reflect(const size_t* index, const size_t n) {
+		iovec* const rx_iov = iov + batch;
+		iovec* const reflect_iov = iov + batch + rx_slots;
+
+		for (size_t i = 0; i < n; ++i)
+			reflect_iov[i] = rx_iov[rx_first + index[i]];
+
+		return send(reflect_iov, n);
+	}
+
+	bool tx_timestamp(uint64_t&) {
+		return false;
+	}
+
+	bool rx_timestamp(const size_t, uint64_t&) {
+		return false;
+	}
+};
+
+#endif // engine_tcp_H__
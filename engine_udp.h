@@ -0,0 +1,375 @@
+#ifndef engine_udp_H__
+#define engine_udp_H__
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include "engine.h"
+#include "transport.h"
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+#ifndef IP_MTU
+#define IP_MTU 14
+#endif
+
+// transport engine: a udp datagram per frame on a socket connected to the peer's worker; a batch of
+// datagrams per send, a single sendmsg segmented by the stack (UDP_SEGMENT, GSO) where it can, and
+// received coalesced (UDP_GRO) where the stack does so, sendmmsg/recvmmsg otherwise
+class engine_udp {
+	enum {
+		segments_max = 64,         // datagrams per GSO send, and per GRO receive, as the kernel has it
+		datagram_max = 65507,      // octets of an ipv4 udp datagram, the GSO send being one
+		header_size = 28           // octets of ip and udp header per datagram
+	};
+
+	int fd;
+	size_t frame_size;
+	size_t payload;  // octets per datagram: the frame past its eth header
+	size_t batch;
+	size_t rx_slots; // frames a receive takes at most
+	size_t segments; // datagrams per send, 0 to send them by sendmmsg
+	bool gro;        // receives come coalesced
+
+	uint8_t* buffer; // batch tx frames followed by rx_slots rx frames, mapped apart from the pool
+	size_t buffer_size;
+	size_t stride;
+	iovec* iov;      // payloads of the batch tx frames, the rx frames, then those of the rx frames
+	                 // as they go back out
+	mmsghdr* msg;    // rx_slots send headers, then rx_slots receive headers
+	size_t* rx_len;  // lengths of the frames of the last receive
+	uint64_t control[8]; // GRO control message
+
+	size_t rx_count; // frames of the last receive
+	size_t rx_next;  // of those, the first not yet handed out
+	size_t rx_first; // first frame of the last rx_acquire
+
+	rx_waiter waiter;
+
+	// send the datagrams of the n payloads, all of them
+	bool send(const iovec* const v, const size_t n) {
+		size_t i = 0;
+
+		while (0 != segments && i < n) {
+			const size_t count = n - i < segments ? n - i : segments;
+
+			msghdr m;
+			memset(&m, 0, sizeof(m));
+			m.msg_iov = const_cast< iovec* >(v + i);
+			m.msg_iovlen = count;
+
+			const ssize_t sent = sendmsg(fd, &m, 0);
+
+			if (0 > sent) {
+				// an icmp error of a datagram before, e.g. from the peer's port not yet bound
+				if (EINTR == errno || ECONNREFUSED == errno)
+					continue;
+
+				// the stack will not segment for the route after all
+				fprintf(stderr, "warning: udp gso send failed, sending by sendmmsg (errno: %s)\n", strerror(errno));
+				segments = 0;
+				break;
+			}
+
+			if (size_t(sent) != count * payload) {
+				fprintf(stderr, "error: sendmsg() failed to send requested byte count\n");
+				return false;
+			}
+
+			i += count;
+		}
+
+		mmsghdr* const m = msg;
+
+		for (size_t j = 0; i + j < n; ++j)
+			m[j].msg_hdr.msg_iov = const_cast< iovec* >(v + i + j);
+
+		for (size_t j = 0; i < n;) {
+			const int sent = sendmmsg(fd, m + j, n - i, 0);
+
+			if (0 > sent) {
+				if (EINTR == errno || ECONNREFUSED == errno)
+					continue;
+
+				fprintf(stderr, "error: sendmmsg() failed (errno: %s)\n", strerror(errno));
+				return false;
+			}
+
+			if (sent < int(n - i))
+				probe_event(probe_short_write);
+
+			i += sent;
+			j += sent;
+		}
+
+		return true;
+	}
+
+	// receive into the rx frames from the first on; the count received, 0 and errno set if none
+	int receive(const size_t n) {
+		if (!gro)
+			return recvmmsg(fd, msg + rx_slots, n, MSG_WAITFORONE | waiter.recv_flags(), 0);
+
+		msghdr m;
+		memset(&m, 0, sizeof(m));
+		m.msg_iov = iov + batch;
+		m.msg_iovlen = rx_slots;
+		m.msg_control = control;
+		m.msg_controllen = sizeof(control);
+
+		const ssize_t recv = recvmsg(fd, &m, waiter.recv_flags());
+
+		if (0 > recv)
+			return -1;
+
+		int gso_size = 0;
+
+		for (cmsghdr* c = CMSG_FIRSTHDR(&m); 0 != c; c = CMSG_NXTHDR(&m, c)) {
+			if (SOL_UDP == c->cmsg_level && UDP_GRO == c->cmsg_type)
+				memcpy(&gso_size, CMSG_DATA(c), sizeof(gso_size));
+		}
+
+		// datagrams coalesced at the payload size fill an rx frame each, the last one perhaps short;
+		// a datagram on its own, or datagrams of another size, go as one frame of the length received
+		if (size_t(gso_size) != payload) {
+			rx_len[0] = ETH_HLEN + size_t(recv);
+			return 1;
+		}
+
+		const size_t count = (size_t(recv) + payload - 1) / payload;
+
+		for (size_t i = 0; i < count; ++i)
+			rx_len[i] = ETH_HLEN + (i + 1 < count ? payload : size_t(recv) - i * payload);
+
+		return int(count);
+	}
+
+public:
+	engine_udp()
+	: fd(-1)
+	, frame_size(0)
+	, payload(0)
+	, batch(0)
+	, rx_slots(0)
+	, segments(0)
+	, gro(false)
+	, buffer(0)
+	, buffer_size(0)
+	, stride(0)
+	, iov(0)
+	, msg(0)
+	, rx_len(0)
+	, rx_count(0)
+	, rx_next(0)
+	, rx_first(0) {
+	}
+
+	~engine_udp() {
+		if (0 <= fd)
+			close(fd);
+
+		if (0 != buffer)
+			munmap(buffer, buffer_size);
+
+		free(iov);
+		free(msg);
+		free(rx_len);
+	}
+
+	bool init(const engine_config& cfg) {
+		frame_size = cfg.frame_size;
+		payload = frame_size - ETH_HLEN;
+		batch = cfg.batch;
+		rx_slots = batch < segments_max ? size_t(segments_max) : batch;
+
+		if (0 != cfg.tag_size) {
+			fprintf(stderr, "error: udp engine: frames go via the ip stack untagged; tag them by a vlan iface instead\n");
+			return false;
+		}
+
+		fd = transport_socket(cfg, SOCK_DGRAM, cfg.local_port, "udp");
+
+		if (0 > fd)
+			return false;
+
+		const sockaddr_in peer = transport_addr(cfg.peer_ip, cfg.peer_port);
+
+		if (0 > connect(fd, reinterpret_cast< const sockaddr* >(&peer), sizeof(peer))) {
+			fprintf(stderr, "error: cannot connect udp socket to the peer (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		int mtu = 0;
+		socklen_t mtulen = sizeof(mtu);
+
+		if (0 > getsockopt(fd, IPPROTO_IP, IP_MTU, &mtu, &mtulen)) {
+			fprintf(stderr, "error: cannot obtain udp path mtu (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		if (payload + header_size > size_t(mtu)) {
+			fprintf(stderr, "error: frame size %zu exceeds path mtu %d with udp, whose headers take %d octets more than the eth header\n",
+					frame_size, mtu, header_size - ETH_HLEN);
+			return false;
+		}
+
+		if (!waiter.init(fd, cfg, true, POLLIN))
+			return false;
+
+		// GSO and GRO are optional extras, the datagrams go one by one without them
+		static bool gso_warned = false;
+		static bool gro_warned = false;
+		const int segment = int(payload);
+		const int on = 1;
+
+		segments = datagram_max / payload < segments_max ? datagram_max / payload : size_t(segments_max);
+
+		if (2 > segments || 0 > setsockopt(fd, SOL_UDP, UDP_SEGMENT, &segment, sizeof(segment))) {
+			if (2 <= segments && !gso_warned) {
+				fprintf(stderr, "warning: cannot set udp gso (errno: %s)\n", strerror(errno));
+				gso_warned = true;
+			}
+
+			segments = 0;
+		}
+
+		gro = 0 <= setsockopt(fd, SOL_UDP, UDP_GRO, &on, sizeof(on));
+
+		if (!gro && !gro_warned) {
+			fprintf(stderr, "warning: cannot set udp gro (errno: %s)\n", strerror(errno));
+			gro_warned = true;
+		}
+
+		stride = cfg.pool->stride();
+		buffer_size = (batch + rx_slots) * stride;
+		buffer = cfg.pool->map(buffer_size);
+		iov = reinterpret_cast< iovec* >(calloc(batch + rx_slots * 2, sizeof(iovec)));
+		msg = reinterpret_cast< mmsghdr* >(calloc(rx_slots * 2, sizeof(mmsghdr)));
+		rx_len = reinterpret_cast< size_t* >(calloc(rx_slots, sizeof(size_t)));
+
+		if (0 == buffer || 0 == iov || 0 == msg || 0 == rx_len) {
+			fprintf(stderr, "error: cannot allocate batch buffers\n");
+			return false;
+		}
+
+		// tx frames are prefilled from the template; only their payloads go out
+		for (size_t i = 0; i < batch; ++i) {
+			uint8_t* const frame = buffer + i * stride;
+
+			memcpy(frame, cfg.frame_tx, frame_size);
+			iov[i].iov_base = frame + ETH_HLEN;
+			iov[i].iov_len = payload;
+		}
+
+		// rx frames get the eth header of frames from the peer once, the payloads landing past it
+		for (size_t i = 0; i < rx_slots; ++i) {
+			uint8_t* const frame = buffer + (batch + i) * stride;
+
+			transport_rx_header(cfg, frame);
+			iov[batch + i].iov_base = frame + ETH_HLEN;
+			iov[batch + i].iov_len = payload;
+			msg[i].msg_hdr.msg_iovlen = 1;
+			msg[rx_slots + i].msg_hdr.msg_iov = iov + batch + i;
+			msg[rx_slots + i].msg_hdr.msg_iovlen = 1;
+		}
+
+		return true;
+	}
+
+	size_t tx_acquire(uint8_t** frame, const size_t n) {
+		const size_t count = n < batch ? n : batch;
+
+		for (size_t i = 0; i < count; ++i)
+			frame[i] = buffer + i * stride;
+
+		return count;
+	}
+
+	bool tx_commit(const size_t n) {
+		assert(n <= batch);
+		return send(iov, n);
+	}
+
+	bool tx_flush() {
+		return true;
+	}
+
+	size_t rx_acquire(const uint8_t** frame, size_t* len, const size_t n) {
+		// frames left over from a coalesced receive go first
+		if (rx_next == rx_count) {
+			int recv;
+
+			for (uint64_t deadline = 0;;) {
+				do
+					recv = receive(rx_slots);
+				while (0 > recv && (EINTR == errno || ECONNREFUSED == errno));
+
+				if (0 < recv)
+					break;
+
+				if (0 == recv)
+					errno = EAGAIN;
+				else if (EAGAIN != errno && EWOULDBLOCK != errno) {
+					fprintf(stderr, "error: udp receive failed (errno: %s)\n", strerror(errno));
+					return 0;
+				}
+
+				if (!waiter.wait(deadline))
+					return 0;
+			}
+
+			if (!gro) {
+				for (int i = 0; i < recv; ++i)
+					rx_len[i] = ETH_HLEN + msg[rx_slots + i].msg_len;
+			}
+
+			rx_count = size_t(recv);
+			rx_next = 0;
+		}
+
+		const size_t count = n < rx_count - rx_next ? n : rx_count - rx_next;
+
+		for (size_t i = 0; i < count; ++i) {
+			frame[i] = buffer + (batch + rx_next + i) * stride;
+			len[i] = rx_len[rx_next + i];
+		}
+
+		rx_first = rx_next;
+		rx_next += count;
+		return count;
+	}
+
+	void rx_release() {
+	}
+
+	bool rx_reflect(const size_t* index, const size_t n) {
+		iovec* const reflect_iov = iov + batch + rx_slots;
+
+		for (size_t i = 0; i < n; ++i)
+			reflect_iov[i] = iov[batch + rx_first + index[i]];
+
+		return send(reflect_iov, n);
+	}
+
+	bool tx_timestamp(uint64_t&) {
+		return false;
+	}
+
+	bool rx_timestamp(const size_t, uint64_t&) {
+		return false;
+	}
+};
+
+#endif // engine_udp_H__
@@ -0,0 +1,746 @@
+#ifndef engine_uring_H__
+#define engine_uring_H__
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include "engine.h"
+#include "timestamp.h"
+
+// asynchronous engine: io_uring atop the packet socket, a ring for either side so that the sides
+// share no state. The rx ring keeps a single multishot receive in flight, the batch of rx frames
+// provided to it by a buffer ring, each frame received a completion of its own and handed back to
+// the buffer ring on release; kernels without buffer rings (5.19, multishot receives 6.0) get a
+// receive in flight per rx frame instead, every frame arriving waking them all. The tx ring takes a
+// chain of sends per commit, the frames of a chain linked so they leave in order, and the next batch
+// is filled in while the last is still going out. The frame memory is registered with the rings, the
+// kernel pinning it once rather than per request, and sends and per-frame receives are the requests
+// taking registered buffers (WRITE_FIXED/READ_FIXED, the socket write and read paths); failing the
+// registration, e.g. for want of locked memory, plain SEND/RECV. Without SQPOLL a commit, and a
+// receive, take one io_uring_enter(); with it a kernel thread, shared by both rings, takes the
+// requests in, and the engine only enters the kernel to wake the thread when idle, or to sleep
+// awaiting completions.
+// Frames reflected go back out from the rx frames they were received into, by way of the tx ring
+class engine_uring {
+	enum {
+		sqpoll_idle_ms = 1000 // SQPOLL thread spins that long without requests before it sleeps
+	};
+
+	// user data of requests not about a frame slot
+	static const uint64_t cancel_data = ~0ULL;
+	static const uint64_t multishot_data = ~1ULL;
+
+	// submission and completion queues as mapped from the kernel
+	struct ring {
+		int fd;
+		bool sqpoll;
+		void* sq_map;
+		size_t sq_map_size;
+		void* cq_map;
+		size_t cq_map_size;
+		io_uring_sqe* sqes;
+		size_t sqes_size;
+		uint32_t* sq_head;
+		uint32_t* sq_tail;
+		uint32_t* sq_flags;
+		uint32_t sq_mask;
+		uint32_t sq_entries;
+		uint32_t* cq_head;
+		uint32_t* cq_tail;
+		uint32_t cq_mask;
+		io_uring_cqe* cqes;
+		uint32_t pending; // requests queued, not yet taken in by the kernel; without SQPOLL
+
+		ring()
+		: fd(-1)
+		, sqpoll(false)
+		, sq_map(MAP_FAILED)
+		, sq_map_size(0)
+		, cq_map(MAP_FAILED)
+		, cq_map_size(0)
+		, sqes(reinterpret_cast< io_uring_sqe* >(MAP_FAILED))
+		, sqes_size(0)
+		, sq_head(0)
+		, sq_tail(0)
+		, sq_flags(0)
+		, sq_mask(0)
+		, sq_entries(0)
+		, cq_head(0)
+		, cq_tail(0)
+		, cq_mask(0)
+		, cqes(0)
+		, pending(0) {
+		}
+
+		~ring() {
+			if (MAP_FAILED != reinterpret_cast< void* >(sqes))
+				munmap(sqes, sqes_size);
+
+			if (MAP_FAILED != cq_map && cq_map != sq_map)
+				munmap(cq_map, cq_map_size);
+
+			if (MAP_FAILED != sq_map)
+				munmap(sq_map, sq_map_size);
+
+			if (0 <= fd)
+				close(fd);
+		}
+
+		static int sys_enter(
+			const int fd,
+			const uint32_t to_submit,
+			const uint32_t min_complete,
+			const uint32_t flags,
+			const void* const arg,
+			const size_t arg_size) {
+
+			return int(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size));
+		}
+
+		bool init(
+			const uint32_t entries,
+			const bool poll_thread, // SQPOLL
+			const int attach_fd) {  // ring to share the SQPOLL thread of, -1 for none
+
+			io_uring_params params;
+			memset(&params, 0, sizeof(params));
+
+			if (poll_thread) {
+				params.flags |= IORING_SETUP_SQPOLL;
+				params.sq_thread_idle = sqpoll_idle_ms;
+			}
+
+			if (0 <= attach_fd) {
+				params.flags |= IORING_SETUP_ATTACH_WQ;
+				params.wq_fd = uint32_t(attach_fd);
+			}
+
+			sqpoll = poll_thread;
+			fd = int(syscall(__NR_io_uring_setup, entries, &params));
+
+			if (0 > fd) {
+				fprintf(stderr, "error: cannot set up io_uring (errno: %s)\n", strerror(errno));
+				return false;
+			}
+
+			if (!(params.features & IORING_FEAT_EXT_ARG)) {
+				fprintf(stderr, "error: io_uring lacks timed waits, kernel 5.11+ required\n");
+				return false;
+			}
+
+			sq_map_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+			cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+			// both queues in one mapping where the kernel has them so
+			if (params.features & IORING_FEAT_SINGLE_MMAP) {
+				if (cq_map_size > sq_map_size)
+					sq_map_size = cq_map_size;
+
+				cq_map_size = sq_map_size;
+			}
+
+			sq_map = mmap(0, sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+
+			if (MAP_FAILED == sq_map) {
+				fprintf(stderr, "error: cannot map io_uring submission queue (errno: %s)\n", strerror(errno));
+				return false;
+			}
+
+			cq_map = params.features & IORING_FEAT_SINGLE_MMAP ? sq_map :
+				mmap(0, cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+
+			if (MAP_FAILED == cq_map) {
+				fprintf(stderr, "error: cannot map io_uring completion queue (errno: %s)\n", strerror(errno));
+				return false;
+			}
+
+			sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+			sqes = reinterpret_cast< io_uring_sqe* >(mmap(0, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+
+			if (MAP_FAILED == reinterpret_cast< void* >(sqes)) {
+				fprintf(stderr, "error: cannot map io_uring submission entries (errno: %s)\n", strerror(errno));
+				return false;
+			}
+
+			uint8_t* const sq = reinterpret_cast< uint8_t* >(sq_map);
+			uint8_t* const cq = reinterpret_cast< uint8_t* >(cq_map);
+
+			sq_head = reinterpret_cast< uint32_t* >(sq + params.sq_off.head);
+			sq_tail = reinterpret_cast< uint32_t* >(sq + params.sq_off.tail);
+			sq_flags = reinterpret_cast< uint32_t* >(sq + params.sq_off.flags);
+			sq_mask = *reinterpret_cast< uint32_t* >(sq + params.sq_off.ring_mask);
+			sq_entries = params.sq_entries;
+			cq_head = reinterpret_cast< uint32_t* >(cq + params.cq_off.head);
+			cq_tail = reinterpret_cast< uint32_t* >(cq + params.cq_off.tail);
+			cq_mask = *reinterpret_cast< uint32_t* >(cq + params.cq_off.ring_mask);
+			cqes = reinterpret_cast< io_uring_cqe* >(cq + params.cq_off.cqes);
+
+			// submission entry i always sits at index i of the array
+			uint32_t* const array = reinterpret_cast< uint32_t* >(sq + params.sq_off.array);
+
+			for (uint32_t i = 0; i < sq_entries; ++i)
+				array[i] = i;
+
+			return true;
+		}
+
+		// register a region of memory for the requests taking registered buffers, as buffer 0
+		bool register_buffer(
+			void* const base,
+			const size_t size) {
+
+			iovec iov;
+			iov.iov_base = base;
+			iov.iov_len = size;
+
+			return 0 == syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, &iov, 1);
+		}
+
+		// queue a request; the queue is sized for all requests the engine keeps in flight
+		void push(
+			const uint8_t opcode,
+			const int sock,
+			const void* const addr,
+			const uint32_t len,
+			const uint64_t data,
+			const uint8_t flags) {
+
+			const uint32_t tail = *sq_tail;
+			assert(tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) < sq_entries);
+
+			io_uring_sqe* const e = sqes + (tail & sq_mask);
+			memset(e, 0, sizeof(*e));
+			e->opcode = opcode;
+			e->flags = flags;
+			e->fd = sock;
+			e->addr = uint64_t(uintptr_t(addr));
+			e->len = len;
+			e->user_data = data;
+
+			__atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+			++pending;
+		}
+
+		// queue a multishot receive of frames of the buffer ring of group 0
+		void push_multishot(
+			const int sock,
+			const uint64_t data) {
+
+			push(IORING_OP_RECV, sock, 0, 0, data, IOSQE_BUFFER_SELECT);
+
+			io_uring_sqe* const e = sqes + ((*sq_tail - 1) & sq_mask);
+			e->ioprio = IORING_RECV_MULTISHOT;
+			e->buf_group = 0;
+		}
+
+		// flags to enter the kernel with for the queued requests to be taken in
+		uint32_t submit_flags() {
+			if (!sqpoll)
+				return 0;
+
+			// the tail store of push ahead of the flags load
+			__atomic_thread_fence(__ATOMIC_SEQ_CST);
+			return __atomic_load_n(sq_flags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP ? IORING_ENTER_SQ_WAKEUP : 0;
+		}
+
+		// have the kernel take in the requests queued, and optionally wait up to the specified ns for
+		// a completion, -1 for no limit; false on error, or with errno EAGAIN when the wait timed out
+		bool enter(
+			const bool wait,
+			const int64_t ns) {
+
+			const uint32_t to_submit = sqpoll ? 0 : pending;
+			const uint32_t flags = submit_flags() | (wait ? IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG : 0);
+
+			pending = sqpoll ? 0 : pending;
+
+			if (0 == to_submit && 0 == flags)
+				return true;
+
+			__kernel_timespec ts;
+			ts.tv_sec = 0 > ns ? 0 : ns / 1000000000;
+			ts.tv_nsec = 0 > ns ? 0 : ns % 1000000000;
+
+			io_uring_getevents_arg arg;
+			memset(&arg, 0, sizeof(arg));
+			arg.ts = 0 > ns ? 0 : uint64_t(uintptr_t(&ts));
+
+			const int res = sys_enter(fd, to_submit, wait ? 1 : 0, flags, wait ? &arg : 0, wait ? sizeof(arg) : 0);
+
+			if (0 > res) {
+				if (ETIME == errno) {
+					errno = EAGAIN;
+					return false;
+				}
+
+				if (EINTR == errno || EAGAIN == errno || EBUSY == errno)
+					return true;
+
+				fprintf(stderr, "error: io_uring_enter() failed (errno: %s)\n", strerror(errno));
+				return false;
+			}
+
+			pending -= uint32_t(res) < pending ? uint32_t(res) : pending;
+			return true;
+		}
+
+		// the oldest completion not yet reaped, 0 if none
+		const io_uring_cqe* peek() const {
+			const uint32_t head = *cq_head;
+
+			if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+				return 0;
+
+			return cqes + (head & cq_mask);
+		}
+
+		void pop() {
+			__atomic_store_n(cq_head, *cq_head + 1, __ATOMIC_RELEASE);
+		}
+	};
+
+	int fd;
+	size_t frame_size;
+	size_t tag_size;
+	uint16_t tci;
+	size_t batch;
+	int timestamp;
+	int poll;
+	int rx_timeout;
+	bool fixed;      // frame memory registered, requests taking registered buffers
+
+	uint8_t* buffer; // batch tx frames followed by batch rx frames, from the pool
+	size_t stride;   // distance of one frame from the next in the buffer
+
+	ring tx;
+	ring rx;
+
+	uint32_t* tx_free;    // tx slots not in flight, a stack, the last tx_acquired of them handed out
+	size_t tx_free_count;
+	size_t tx_acquired;
+	uint32_t* tx_chain;   // slots of a chain of sends being put together
+	uint32_t* tx_retry;   // slots of the sends to go again
+	size_t reflecting;    // reflected frames in flight
+
+	uint32_t* rx_taken;   // rx slots of the frames from the last rx_acquire, in order of arrival
+	size_t rx_acquired;
+	size_t rx_inflight;   // receives in flight
+
+	// buffer ring providing the rx frames to a multishot receive, 0 if none; entries as laid out by
+	// the kernel, the tail overlaid on the reserved field of the first, as io_uring_buf_ring has it -
+	// its flexible array sits past an empty struct, which takes room in C++
+	io_uring_buf* rx_bufs;
+	size_t rx_bufs_size;
+	uint16_t rx_bufs_mask;
+	uint16_t rx_bufs_tail;
+
+	// slot s: tx frames first, rx ones following; frames sit tag_size octets into their slots, sends
+	// going from the start of the slot
+	uint8_t* slot(const size_t s) const {
+		return buffer + s * stride;
+	}
+
+	void push_send(
+		const uint32_t s,
+		const bool link) {
+
+		tx.push(fixed ? uint8_t(IORING_OP_WRITE_FIXED) : uint8_t(IORING_OP_SEND), fd, slot(s), uint32_t(frame_size + tag_size), s, link ? IOSQE_IO_LINK : 0);
+	}
+
+	// have rx slot r receive a frame: provide it to the multishot receive, or put a receive of its own
+	// in flight
+	void push_recv(const uint32_t r) {
+		uint8_t* const frame = slot(batch + r) + tag_size;
+
+		if (0 == rx_bufs) {
+			rx.push(fixed ? uint8_t(IORING_OP_READ_FIXED) : uint8_t(IORING_OP_RECV), fd, frame, uint32_t(frame_size), r, 0);
+			++rx_inflight;
+			return;
+		}
+
+		io_uring_buf& b = rx_bufs[rx_bufs_tail & rx_bufs_mask];
+		b.addr = uint64_t(uintptr_t(frame));
+		b.len = uint32_t(frame_size);
+		b.bid = uint16_t(r);
+
+		__atomic_store_n(&rx_bufs[0].resv, ++rx_bufs_tail, __ATOMIC_RELEASE);
+	}
+
+	// put the multishot receive in flight, unless it is; it ends once out of frames to receive into
+	void arm() {
+		if (0 == rx_bufs || 0 != rx_inflight)
+			return;
+
+		rx.push_multishot(fd, multishot_data);
+		++rx_inflight;
+	}
+
+	// set up the buffer ring of the multishot receive, entries a power of two; false if the kernel
+	// has no buffer rings
+	bool init_bufs(
+		frame_pool& pool,
+		const uint32_t entries) {
+
+		rx_bufs_size = entries * sizeof(io_uring_buf);
+		rx_bufs = reinterpret_cast< io_uring_buf* >(pool.map(rx_bufs_size));
+
+		if (0 == rx_bufs)
+			return false;
+
+		io_uring_buf_reg reg;
+		memset(&reg, 0, sizeof(reg));
+		reg.ring_addr = uint64_t(uintptr_t(rx_bufs));
+		reg.ring_entries = entries;
+		reg.bgid = 0;
+
+		if (0 != syscall(__NR_io_uring_register, rx.fd, IORING_REGISTER_PBUF_RING, &reg, 1)) {
+			munmap(rx_bufs, rx_bufs_size);
+			rx_bufs = 0;
+			return false;
+		}
+
+		rx_bufs_mask = uint16_t(entries - 1);
+		rx_bufs_tail = 0;
+		return true;
+	}
+
+	// send the specified slots, in order, as a chain
+	bool send(
+		const uint32_t* const s,
+		const size_t n) {
+
+		for (size_t i = 0; i < n; ++i)
+			push_send(s[i], i + 1 < n);
+
+		return tx.enter(false, -1);
+	}
+
+	// take in the outcomes of the sends completed: tx slots go back to the free ones, reflected frames
+	// are counted off; sends the device queue had no room for go again, along with those cancelled
+	// behind them in their chain, in order
+	bool tx_reap() {
+		size_t retry = 0;
+
+		for (const io_uring_cqe* c; 0 != (c = tx.peek()); tx.pop()) {
+			const uint32_t s = uint32_t(c->user_data);
+
+			if (int(frame_size + tag_size) == c->res) {
+				if (s < batch)
+					tx_free[tx_free_count++] = s;
+				else
+					--reflecting;
+
+				continue;
+			}
+
+			if (-ENOBUFS == c->res || -EAGAIN == c->res || -ECANCELED == c->res) {
+				if (-ECANCELED != c->res)
+					probe_event(probe_tx_busy);
+
+				tx_retry[retry++] = s;
+				continue;
+			}
+
+			if (0 <= c->res)
+				fprintf(stderr, "error: io_uring send failed to send requested byte count\n");
+			else
+				fprintf(stderr, "error: io_uring send failed (errno: %s)\n", strerror(-c->res));
+
+			return false;
+		}
+
+		return 0 == retry || send(tx_retry, retry);
+	}
+
+	// ns left to the rx deadline, -1 for none; 0 and errno EAGAIN once the deadline has passed
+	int64_t rx_remaining(uint64_t& deadline) const {
+		if (0 > rx_timeout)
+			return -1;
+
+		const uint64_t now = timer_ns();
+
+		if (0 == deadline)
+			deadline = now + uint64_t(rx_timeout) * 1000000;
+
+		if (now >= deadline) {
+			errno = EAGAIN;
+			return 0;
+		}
+
+		return int64_t(deadline - now);
+	}
+
+public:
+	engine_uring()
+	: fd(-1)
+	, frame_size(0)
+	, tag_size(0)
+	, tci(0)
+	, batch(0)
+	, timestamp(timestamp_none)
+	, poll(rx_poll_block)
+	, rx_timeout(-1)
+	, fixed(false)
+	, buffer(0)
+	, stride(0)
+	, tx_free(0)
+	, tx_free_count(0)
+	, tx_acquired(0)
+	, tx_chain(0)
+	, tx_retry(0)
+	, reflecting(0)
+	, rx_taken(0)
+	, rx_acquired(0)
+	, rx_inflight(0)
+	, rx_bufs(0)
+	, rx_bufs_size(0)
+	, rx_bufs_mask(0)
+	, rx_bufs_tail(0) {
+	}
+
+	~engine_uring() {
+		// the receives in flight get cancelled and awaited, rather than left to the ring teardown,
+		// which may complete them after the frame memory has gone
+		if (0 <= rx.fd && 0 != rx_inflight) {
+			for (uint32_t r = 0; r < (0 == rx_bufs ? batch : 0); ++r)
+				rx.push(IORING_OP_ASYNC_CANCEL, -1, reinterpret_cast< const void* >(uintptr_t(r)), 0, cancel_data, 0);
+
+			if (0 != rx_bufs)
+				rx.push(IORING_OP_ASYNC_CANCEL, -1, reinterpret_cast< const void* >(uintptr_t(multishot_data)), 0, cancel_data, 0);
+
+			for (int tries = 0; 0 != rx_inflight && 100 > tries; ++tries) {
+				for (const io_uring_cqe* c; 0 != (c = rx.peek()); rx.pop()) {
+					if (cancel_data != c->user_data && !(c->flags & IORING_CQE_F_MORE))
+						--rx_inflight;
+				}
+
+				if (0 != rx_inflight && !rx.enter(true, 10000000) && EAGAIN != errno)
+					break;
+			}
+		}
+
+		free(tx_free);
+		free(tx_chain);
+		free(tx_retry);
+		free(rx_taken);
+
+		if (0 != rx_bufs)
+			munmap(rx_bufs, rx_bufs_size);
+	}
+
+	bool init(const engine_config& cfg) {
+		fd = cfg.fd;
+		frame_size = cfg.frame_size;
+		tag_size = cfg.tag_size;
+		tci = cfg.tci;
+		batch = cfg.batch;
+		timestamp = cfg.timestamp;
+		poll = cfg.poll;
+		rx_timeout = cfg.rx_timeout;
+
+		// a batch of requests in flight per ring, and room for as many cancellations at the end; the
+		// SQPOLL thread of the tx ring, if any, serves the rx ring too
+		if (!tx.init(uint32_t(batch * 2), cfg.sqpoll, -1) ||
+			!rx.init(uint32_t(batch * 2), cfg.sqpoll, cfg.sqpoll ? tx.fd : -1))
+			return false;
+
+		buffer = cfg.pool->take(batch * 2);
+		stride = cfg.pool->stride();
+		tx_free = reinterpret_cast< uint32_t* >(calloc(batch, sizeof(uint32_t)));
+		tx_chain = reinterpret_cast< uint32_t* >(calloc(batch, sizeof(uint32_t)));
+		tx_retry = reinterpret_cast< uint32_t* >(calloc(batch, sizeof(uint32_t)));
+		rx_taken = reinterpret_cast< uint32_t* >(calloc(batch, sizeof(uint32_t)));
+
+		if (0 == buffer || 0 == tx_free || 0 == tx_chain || 0 == tx_retry || 0 == rx_taken) {
+			fprintf(stderr, "error: cannot allocate batch buffers\n");
+			return false;
+		}
+
+		fixed = tx.register_buffer(buffer, batch * 2 * stride) && rx.register_buffer(buffer, batch * 2 * stride);
+
+		if (!fixed) {
+			static bool warned = false;
+
+			if (!warned) {
+				fprintf(stderr, "warning: cannot register frame memory with io_uring, using unregistered buffers (errno: %s)\n", strerror(errno));
+				warned = true;
+			}
+		}
+
+		// tx frames are prefilled from the template, tagged if tagging
+		for (uint32_t i = 0; i < batch; ++i) {
+			memcpy(slot(i), cfg.frame_tx - tag_size, frame_size + tag_size);
+			tx_free[tx_free_count++] = i;
+		}
+
+		// a buffer ring of a power of two entries, for the multishot receive
+		uint32_t entries = 1;
+
+		while (entries < batch)
+			entries *= 2;
+
+		init_bufs(*cfg.pool, entries);
+
+		// every rx frame starts out in flight
+		for (uint32_t r = 0; r < batch; ++r)
+			push_recv(r);
+
+		arm();
+		return rx.enter(false, -1);
+	}
+
+	size_t tx_acquire(uint8_t** frame, const size_t n) {
+		if (!tx_reap())
+			return 0;
+
+		while (0 == tx_free_count) {
+			if ((!tx.enter(true, -1) && EAGAIN != errno) || !tx_reap())
+				return 0;
+		}
+
+		const size_t count = n < tx_free_count ? n : tx_free_count;
+
+		for (size_t i = 0; i < count; ++i)
+			frame[i] = slot(tx_free[tx_free_count - count + i]) + tag_size;
+
+		tx_acquired = count;
+		return count;
+	}
+
+	bool tx_commit(const size_t n) {
+		assert(n <= tx_acquired);
+
+		// the slots committed leave the stack, those acquired but not committed stay on top
+		uint32_t* const taken = tx_free + tx_free_count - tx_acquired;
+
+		memcpy(tx_chain, taken, n * sizeof(uint32_t));
+		memmove(taken, taken + n, (tx_acquired - n) * sizeof(uint32_t));
+		tx_free_count -= n;
+		tx_acquired = 0;
+
+		return send(tx_chain, n);
+	}
+
+	bool tx_flush() {
+		while (batch != tx_free_count) {
+			if (!tx_reap())
+				return false;
+
+			if (batch != tx_free_count && !tx.enter(true, -1) && EAGAIN != errno)
+				return false;
+		}
+
+		return true;
+	}
+
+	size_t rx_acquire(const uint8_t** frame, size_t* len, const size_t n) {
+		const size_t count = n < batch ? n : batch;
+		size_t recv = 0;
+
+		for (uint64_t deadline = 0;;) {
+			for (const io_uring_cqe* c; recv < count && 0 != (c = rx.peek()); rx.pop()) {
+				const bool multishot = multishot_data == c->user_data;
+				const uint32_t r = multishot ? c->flags >> IORING_CQE_BUFFER_SHIFT : uint32_t(c->user_data);
+
+				if (!(multishot && c->flags & IORING_CQE_F_MORE))
+					--rx_inflight;
+
+				// the multishot receive out of frames; it goes back in flight with the frames
+				if (multishot && -ENOBUFS == c->res)
+					continue;
+
+				if (0 <= c->res && (!multishot || c->flags & IORING_CQE_F_BUFFER)) {
+					rx_taken[recv] = r;
+					frame[recv] = slot(batch + r) + tag_size;
+					len[recv] = size_t(c->res);
+					++recv;
+					continue;
+				}
+
+				if (!multishot && (-EINTR == c->res || -EAGAIN == c->res)) {
+					push_recv(r);
+					continue;
+				}
+
+				fprintf(stderr, "error: io_uring receive failed (errno: %s)\n", strerror(-c->res));
+				return 0;
+			}
+
+			// frames released since the last call go back in flight along the way
+			if (0 != recv) {
+				rx_acquired = recv;
+				return rx.enter(false, -1) ? recv : 0;
+			}
+
+			// all frames are provided again by now
+			arm();
+
+			const int64_t ns = rx_remaining(deadline);
+
+			if (0 == ns)
+				return 0;
+
+			// busy mode spins on the completion queue, entering the kernel for it to post completions
+			// unless an SQPOLL thread does so; the others sleep in the kernel awaiting them
+			if (rx_poll_busy == poll) {
+				if (!rx.enter(!rx.sqpoll, 0) && EAGAIN != errno)
+					return 0;
+
+				cpu_relax();
+			}
+			else if (!rx.enter(true, ns) && EAGAIN != errno)
+				return 0;
+		}
+	}
+
+	void rx_release() {
+		for (size_t i = 0; i < rx_acquired; ++i)
+			push_recv(rx_taken[i]);
+
+		rx_acquired = 0;
+		arm();
+	}
+
+	bool rx_reflect(const size_t* index, const size_t n) {
+		for (size_t i = 0; i < n; ++i) {
+			if (0 != tag_size)
+				vlan_insert(slot(batch + rx_taken[index[i]]) + tag_size, tci);
+
+			tx_chain[i] = uint32_t(batch + rx_taken[index[i]]);
+		}
+
+		reflecting += n;
+
+		if (!send(tx_chain, n))
+			return false;
+
+		// the frames go back in flight as receives only once sent
+		while (0 != reflecting) {
+			if (!tx_reap())
+				return false;
+
+			if (0 != reflecting && !tx.enter(true, -1) && EAGAIN != errno)
+				return false;
+		}
+
+		rx_release();
+		return true;
+	}
+
+	bool tx_timestamp(uint64_t& ns) {
+		return timestamp_none != timestamp && errqueue_timestamp(fd, timestamp, ns, timestamp_wait_ms);
+	}
+
+	bool rx_timestamp(const size_t, uint64_t&) {
+		return false;
+	}
+};
+
+#endif // engine_uring_H__
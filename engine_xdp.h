@@ -0,0 +1,645 @@
+#ifndef engine_xdp_H__
+#define engine_xdp_H__
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <arpa/inet.h>
+#include <net/ethernet.h>
+#include <linux/bpf.h>
+#include <linux/if_link.h>
+#include <linux/if_xdp.h>
+#include "engine.h"
+
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+
+// kernel-bypass engine: an AF_XDP socket bound to one queue of the iface, with a UMEM split in
+// two halves - the rx half circulates through the fill and rx rings, the tx half, prefilled from
+// the template frame, through the tx and completion rings; a minimal XDP program redirects frames
+// of our protocol from that queue to the socket, tagged or not, everything else goes on to the kernel
+// stack.
+// Frames reflected go from the rx ring straight onto the tx ring, and their chunks back to the
+// fill ring once completed
+class engine_xdp {
+	enum {
+		ring_size   = 2048,          // descriptors per ring; a power of two
+		umem_nr     = ring_size * 2, // UMEM chunks - one ring's worth for rx, one for tx
+		headroom    = 256,           // XDP_PACKET_HEADROOM, in front of rx frames
+		xsk_map_max = 64             // queues covered by the xsk map
+	};
+
+	// producer/consumer ring as mapped from the socket
+	struct ring {
+		uint32_t* producer;
+		uint32_t* consumer;
+		uint32_t* flags;
+		void* desc;
+		void* map;
+		size_t map_size;
+		uint32_t cached;   // producer rings: local producer; consumer rings: local consumer
+
+		ring()
+		: producer(0)
+		, consumer(0)
+		, flags(0)
+		, desc(0)
+		, map(MAP_FAILED)
+		, map_size(0)
+		, cached(0) {
+		}
+
+		~ring() {
+			if (MAP_FAILED != map)
+				munmap(map, map_size);
+		}
+
+		uint64_t* addr(const uint32_t i) const {
+			return reinterpret_cast< uint64_t* >(desc) + (i & (ring_size - 1));
+		}
+
+		xdp_desc* frame(const uint32_t i) const {
+			return reinterpret_cast< xdp_desc* >(desc) + (i & (ring_size - 1));
+		}
+
+		// producer side: free entries; consumer side: entries available
+		uint32_t free_entries() const {
+			return ring_size - (cached - __atomic_load_n(consumer, __ATOMIC_ACQUIRE));
+		}
+
+		uint32_t avail_entries() const {
+			return __atomic_load_n(producer, __ATOMIC_ACQUIRE) - cached;
+		}
+
+		void produce() {
+			__atomic_store_n(producer, cached, __ATOMIC_RELEASE);
+		}
+
+		void consume() {
+			__atomic_store_n(consumer, cached, __ATOMIC_RELEASE);
+		}
+
+		bool needs_wakeup() const {
+			return 0 != (XDP_RING_NEED_WAKEUP & __atomic_load_n(flags, __ATOMIC_RELAXED));
+		}
+	};
+
+	// XDP program and xsk map, shared by all engines in the process - an iface takes a single program
+	struct program {
+		int map_fd;
+		int prog_fd;
+		int link_fd;
+		size_t users;
+	};
+
+	static program& shared() {
+		static program prog = { -1, -1, -1, 0 };
+		return prog;
+	}
+
+	int fd;
+	bool attached;
+	size_t frame_size;
+	size_t tag_size;
+	uint16_t tci;
+	size_t batch;
+	size_t chunk_size;
+
+	uint8_t* umem;
+	size_t umem_size;
+
+	ring rx;
+	ring tx;
+	ring fill;
+	ring comp;
+
+	rx_waiter waiter;
+
+	// free tx chunks, as a stack of UMEM addresses
+	uint64_t* tx_free;
+	size_t tx_free_nr;
+	size_t tx_acquired;
+	size_t tx_pending;     // produced to the tx ring, not yet kicked
+	size_t tx_outstanding; // produced to the tx ring, not yet completed
+
+	size_t rx_taken;
+	uint64_t rx_addr[batch_max]; // UMEM addresses of the frames from the last rx_acquire, untagged
+
+	static long sys_bpf(const int cmd, bpf_attr& attr) {
+		return syscall(__NR_bpf, cmd, &attr, sizeof(attr));
+	}
+
+	static bpf_insn insn(const uint8_t code, const uint8_t dst, const uint8_t src, const int16_t off, const int32_t imm) {
+		bpf_insn i;
+		i.code = code;
+		i.dst_reg = dst;
+		i.src_reg = src;
+		i.off = off;
+		i.imm = imm;
+		return i;
+	}
+
+	bool mmap_ring(ring& r, const xdp_ring_offset& off, const size_t desc_size, const off_t pgoff) {
+		r.map_size = off.desc + ring_size * desc_size;
+		r.map = mmap(0, r.map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, pgoff);
+
+		if (MAP_FAILED == r.map) {
+			fprintf(stderr, "error: cannot map xsk ring (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		uint8_t* const base = reinterpret_cast< uint8_t* >(r.map);
+		r.producer = reinterpret_cast< uint32_t* >(base + off.producer);
+		r.consumer = reinterpret_cast< uint32_t* >(base + off.consumer);
+		r.flags = reinterpret_cast< uint32_t* >(base + off.flags);
+		r.desc = base + off.desc;
+		return true;
+	}
+
+	// load an XDP program redirecting frames of the given protocol to the xsk map entry of their rx queue
+	bool load_prog(const uint16_t proto) {
+		bpf_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.map_type = BPF_MAP_TYPE_XSKMAP;
+		attr.key_size = sizeof(uint32_t);
+		attr.value_size = sizeof(uint32_t);
+		attr.max_entries = xsk_map_max;
+
+		program& p = shared();
+		p.map_fd = sys_bpf(BPF_MAP_CREATE, attr);
+
+		if (0 > p.map_fd) {
+			fprintf(stderr, "error: cannot create xsk map (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		const uint8_t r0 = BPF_REG_0, r1 = BPF_REG_1, r2 = BPF_REG_2, r3 = BPF_REG_3, r4 = BPF_REG_4, r6 = BPF_REG_6;
+		const bpf_insn prog[] = {
+			insn(BPF_ALU64 | BPF_MOV | BPF_X, r6, r1, 0, 0),                                   //  0: r6 = ctx
+			insn(BPF_LDX | BPF_MEM | BPF_W, r2, r6, offsetof(xdp_md, data), 0),                //  1: r2 = data
+			insn(BPF_LDX | BPF_MEM | BPF_W, r3, r6, offsetof(xdp_md, data_end), 0),            //  2: r3 = data_end
+			insn(BPF_ALU64 | BPF_MOV | BPF_X, r4, r2, 0, 0),                                   //  3: r4 = data
+			insn(BPF_ALU64 | BPF_ADD | BPF_K, r4, 0, 0, ETH_HLEN + vlan_tag_size),             //  4: r4 += ETH_HLEN + tag
+			insn(BPF_JMP | BPF_JGT | BPF_X, r4, r3, 10, 0),                                    //  5: if r4 > data_end goto 16
+			insn(BPF_LDX | BPF_MEM | BPF_H, r4, r2, 12, 0),                                    //  6: r4 = eth proto
+			insn(BPF_JMP | BPF_JNE | BPF_K, r4, 0, 1, htons(ETH_P_8021Q)),                     //  7: if r4 != 802.1Q goto 9
+			insn(BPF_LDX | BPF_MEM | BPF_H, r4, r2, 16, 0),                                    //  8: r4 = eth proto past the tag
+			insn(BPF_JMP | BPF_JNE | BPF_K, r4, 0, 6, htons(proto)),                           //  9: if r4 != proto goto 16
+			insn(BPF_LDX | BPF_MEM | BPF_W, r2, r6, offsetof(xdp_md, rx_queue_index), 0),      // 10: r2 = rx queue
+			insn(BPF_LD | BPF_DW | BPF_IMM, r1, BPF_PSEUDO_MAP_FD, 0, p.map_fd),               // 11: r1 = xsk map
+			insn(0, 0, 0, 0, 0),                                                               // 12
+			insn(BPF_ALU64 | BPF_MOV | BPF_K, r3, 0, 0, XDP_PASS),                             // 13: r3 = XDP_PASS on miss
+			insn(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map),                          // 14: r0 = redirect_map(r1, r2, r3)
+			insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0),                                              // 15: return r0
+			insn(BPF_ALU64 | BPF_MOV | BPF_K, r0, 0, 0, XDP_PASS),                             // 16: r0 = XDP_PASS
+			insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0)                                               // 17: return r0
+		};
+		static char log[4096];
+		static const char license[] = "Dual BSD/GPL";
+
+		memset(&attr, 0, sizeof(attr));
+		attr.prog_type = BPF_PROG_TYPE_XDP;
+		attr.expected_attach_type = BPF_XDP;
+		attr.insns = uint64_t(uintptr_t(prog));
+		attr.insn_cnt = sizeof(prog) / sizeof(prog[0]);
+		attr.license = uint64_t(uintptr_t(license));
+		attr.log_buf = uint64_t(uintptr_t(log));
+		attr.log_size = sizeof(log);
+		attr.log_level = 1;
+
+		p.prog_fd = sys_bpf(BPF_PROG_LOAD, attr);
+
+		if (0 > p.prog_fd) {
+			fprintf(stderr, "error: cannot load xdp program (errno: %s)\n%s\n", strerror(errno), log);
+			return false;
+		}
+
+		return true;
+	}
+
+	// attach the XDP program to the iface - natively if the driver allows, generically otherwise
+	bool attach_prog(const uint32_t ifindex) {
+		const uint32_t mode[] = { XDP_FLAGS_DRV_MODE, XDP_FLAGS_SKB_MODE };
+		const char* const mode_name[] = { "native", "generic" };
+		program& p = shared();
+
+		for (size_t i = 0; i < sizeof(mode) / sizeof(mode[0]); ++i) {
+			bpf_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.link_create.prog_fd = p.prog_fd;
+			attr.link_create.target_ifindex = ifindex;
+			attr.link_create.attach_type = BPF_XDP;
+			attr.link_create.flags = mode[i];
+
+			p.link_fd = sys_bpf(BPF_LINK_CREATE, attr);
+
+			if (0 <= p.link_fd) {
+				printf("xdp program attached in %s mode\n", mode_name[i]);
+				return true;
+			}
+		}
+
+		fprintf(stderr, "error: cannot attach xdp program (errno: %s)\n", strerror(errno));
+		return false;
+	}
+
+	// reclaim completed tx chunks; those of the rx half, reflected, go back to the fill ring
+	void reclaim() {
+		const uint32_t avail = comp.avail_entries();
+		const uint64_t rx_half = uint64_t(ring_size) * chunk_size;
+		bool refilled = false;
+
+		for (uint32_t i = 0; i < avail; ++i) {
+			const uint64_t addr = *comp.addr(comp.cached++);
+
+			if (addr < rx_half) {
+				*fill.addr(fill.cached++) = addr;
+				refilled = true;
+			}
+			else
+				tx_free[tx_free_nr++] = addr;
+		}
+
+		if (refilled)
+			fill.produce();
+
+		if (avail) {
+			comp.consume();
+			tx_outstanding -= avail;
+		}
+	}
+
+	bool kick() {
+		tx_pending = 0;
+
+		if (!tx.needs_wakeup())
+			return true;
+
+		if (0 <= sendto(fd, 0, 0, MSG_DONTWAIT, 0, 0))
+			return true;
+
+		// transient conditions - the frames remain on the tx ring for the next kick
+		if (EAGAIN == errno || EBUSY == errno || ENOBUFS == errno || ENETDOWN == errno || EINTR == errno) {
+			probe_event(probe_tx_busy);
+			return true;
+		}
+
+		fprintf(stderr, "error: sendto() failed to kick xsk tx ring (errno: %s)\n", strerror(errno));
+		return false;
+	}
+
+	// wait for the socket to signal the specified events, up to timeout ms, or indefinitely if -1
+	bool wait(const short events, const int timeout) const {
+		pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = events;
+		pfd.revents = 0;
+
+		const int res = poll(&pfd, 1, timeout);
+
+		// a timeout is no error, but the caller has to give up all the same
+		if (0 == res) {
+			errno = EAGAIN;
+			return false;
+		}
+
+		if (0 > res && EINTR != errno) {
+			fprintf(stderr, "error: poll() failed (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		return true;
+	}
+
+public:
+	engine_xdp()
+	: fd(-1)
+	, attached(false)
+	, frame_size(0)
+	, tag_size(0)
+	, tci(0)
+	, batch(0)
+	, chunk_size(0)
+	, umem(reinterpret_cast< uint8_t* >(MAP_FAILED))
+	, umem_size(0)
+	, tx_free(0)
+	, tx_free_nr(0)
+	, tx_acquired(0)
+	, tx_pending(0)
+	, tx_outstanding(0)
+	, rx_taken(0) {
+	}
+
+	~engine_xdp() {
+		// the last user closes the link, which detaches the program from the iface
+		program& p = shared();
+
+		if (attached && 0 == --p.users) {
+			if (0 <= p.link_fd)
+				close(p.link_fd);
+			if (0 <= p.prog_fd)
+				close(p.prog_fd);
+			if (0 <= p.map_fd)
+				close(p.map_fd);
+
+			p.link_fd = -1;
+			p.prog_fd = -1;
+			p.map_fd = -1;
+		}
+		if (0 <= fd)
+			close(fd);
+		if (MAP_FAILED != umem)
+			munmap(umem, umem_size);
+		free(tx_free);
+	}
+
+	bool init(const engine_config& cfg) {
+		frame_size = cfg.frame_size;
+		tag_size = cfg.tag_size;
+		tci = cfg.tci;
+		batch = cfg.batch;
+		chunk_size = frame_size + vlan_tag_size + headroom > 2048 ? 4096 : 2048;
+
+		if (frame_size + vlan_tag_size + headroom > chunk_size) {
+			fprintf(stderr, "error: frame size exceeds xdp chunk\n");
+			return false;
+		}
+
+		fd = socket(AF_XDP, SOCK_RAW, 0);
+
+		if (0 > fd) {
+			fprintf(stderr, "error: cannot create xdp socket (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		// the umem comes backed and bound like the worker's frame pool
+		umem_size = chunk_size * size_t(umem_nr);
+		umem = cfg.pool->map(umem_size);
+		umem = 0 != umem ? umem : reinterpret_cast< uint8_t* >(MAP_FAILED);
+		tx_free = reinterpret_cast< uint64_t* >(malloc(sizeof(uint64_t) * ring_size));
+
+		if (MAP_FAILED == umem || 0 == tx_free) {
+			fprintf(stderr, "error: cannot allocate umem\n");
+			return false;
+		}
+
+		xdp_umem_reg reg;
+		memset(&reg, 0, sizeof(reg));
+		reg.addr = uint64_t(uintptr_t(umem));
+		reg.len = umem_size;
+		reg.chunk_size = chunk_size;
+		reg.headroom = 0;
+
+		if (0 > setsockopt(fd, SOL_XDP, XDP_UMEM_REG, &reg, sizeof(reg))) {
+			fprintf(stderr, "error: cannot register umem (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		const int size = ring_size;
+
+		if (0 > setsockopt(fd, SOL_XDP, XDP_UMEM_FILL_RING, &size, sizeof(size)) ||
+			0 > setsockopt(fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &size, sizeof(size)) ||
+			0 > setsockopt(fd, SOL_XDP, XDP_RX_RING, &size, sizeof(size)) ||
+			0 > setsockopt(fd, SOL_XDP, XDP_TX_RING, &size, sizeof(size))) {
+
+			fprintf(stderr, "error: cannot set up xsk rings (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		xdp_mmap_offsets off;
+		socklen_t optlen = sizeof(off);
+
+		if (0 > getsockopt(fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen)) {
+			fprintf(stderr, "error: cannot obtain xsk ring offsets (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		if (!mmap_ring(fill, off.fr, sizeof(uint64_t), XDP_UMEM_PGOFF_FILL_RING) ||
+			!mmap_ring(comp, off.cr, sizeof(uint64_t), XDP_UMEM_PGOFF_COMPLETION_RING) ||
+			!mmap_ring(rx, off.rx, sizeof(xdp_desc), XDP_PGOFF_RX_RING) ||
+			!mmap_ring(tx, off.tx, sizeof(xdp_desc), XDP_PGOFF_TX_RING)) {
+			return false;
+		}
+
+		// first half of the umem goes to the fill ring, second half is prefilled for tx
+		fill.cached = *fill.producer;
+		comp.cached = *comp.consumer;
+		rx.cached = *rx.consumer;
+		tx.cached = *tx.producer;
+
+		for (size_t i = 0; i < ring_size; ++i)
+			*fill.addr(fill.cached++) = i * chunk_size;
+
+		fill.produce();
+
+		for (size_t i = ring_size; i < umem_nr; ++i) {
+			memcpy(umem + i * chunk_size, cfg.frame_tx - tag_size, frame_size + tag_size);
+			tx_free[tx_free_nr++] = i * chunk_size;
+		}
+
+		// bind to the queue - zero-copy if the driver supports it, copy mode otherwise
+		sockaddr_xdp sxdp;
+		memset(&sxdp, 0, sizeof(sxdp));
+		sxdp.sxdp_family = AF_XDP;
+		sxdp.sxdp_flags = XDP_USE_NEED_WAKEUP;
+		sxdp.sxdp_ifindex = cfg.saddr->sll_ifindex;
+		sxdp.sxdp_queue_id = cfg.queue;
+
+		if (0 > bind(fd, reinterpret_cast< sockaddr* >(&sxdp), sizeof(sxdp))) {
+			fprintf(stderr, "error: cannot bind xdp socket to queue %u (errno: %s)\n", cfg.queue, strerror(errno));
+			return false;
+		}
+
+		xdp_options opts;
+		optlen = sizeof(opts);
+
+		if (0 > getsockopt(fd, SOL_XDP, XDP_OPTIONS, &opts, &optlen))
+			opts.flags = 0;
+
+		printf("xdp socket bound to queue %u in %s mode\n", cfg.queue, (XDP_OPTIONS_ZEROCOPY & opts.flags) ? "zero-copy" : "copy");
+
+		// engines get initialised one at a time, the first one sets up the program
+		program& p = shared();
+		attached = true;
+
+		if (0 == p.users++ && (!load_prog(ntohs(cfg.saddr->sll_protocol)) || !attach_prog(cfg.saddr->sll_ifindex)))
+			return false;
+
+		if (xsk_map_max <= cfg.queue) {
+			fprintf(stderr, "error: queue %u exceeds xsk map\n", cfg.queue);
+			return false;
+		}
+
+		bpf_attr attr;
+		const uint32_t key = cfg.queue;
+		const uint32_t value = fd;
+
+		memset(&attr, 0, sizeof(attr));
+		attr.map_fd = p.map_fd;
+		attr.key = uint64_t(uintptr_t(&key));
+		attr.value = uint64_t(uintptr_t(&value));
+
+		if (0 > sys_bpf(BPF_MAP_UPDATE_ELEM, attr)) {
+			fprintf(stderr, "error: cannot insert xdp socket in xsk map (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		return waiter.init(fd, cfg, false, POLLIN);
+	}
+
+	size_t tx_acquire(uint8_t** frame, const size_t n) {
+		for (;;) {
+			reclaim();
+
+			const size_t room = tx.free_entries();
+			size_t count = n < tx_free_nr ? n : tx_free_nr;
+			count = count < room ? count : room;
+
+			if (0 != count) {
+				for (size_t i = 0; i < count; ++i)
+					frame[i] = umem + tx_free[tx_free_nr - 1 - i] + tag_size;
+
+				tx_acquired = count;
+				return count;
+			}
+
+			// all chunks in flight - have the kernel get on with them
+			if (!kick())
+				return 0;
+
+			if (0 == comp.avail_entries() && !wait(POLLOUT, -1))
+				return 0;
+		}
+	}
+
+	bool tx_commit(const size_t n) {
+		assert(n <= tx_acquired);
+
+		for (size_t i = 0; i < n; ++i) {
+			xdp_desc* const desc = tx.frame(tx.cached++);
+			desc->addr = tx_free[--tx_free_nr];
+			desc->len = frame_size + tag_size;
+			desc->options = 0;
+		}
+
+		tx.produce();
+		tx_acquired = 0;
+		tx_pending += n;
+		tx_outstanding += n;
+
+		if (tx_pending >= batch)
+			return kick();
+
+		return true;
+	}
+
+	bool tx_flush() {
+		while (0 != tx_outstanding) {
+			if (!kick())
+				return false;
+
+			reclaim();
+		}
+
+		return true;
+	}
+
+	size_t rx_acquire(const uint8_t** frame, size_t* len, const size_t n) {
+		uint32_t avail;
+		uint64_t deadline = 0;
+
+		while (0 == (avail = rx.avail_entries())) {
+			if (!waiter.wait(deadline))
+				return 0;
+		}
+
+		const size_t count = n < avail ? n : avail;
+
+		// frames come as they are on the wire, so any tag is for us to take off
+		for (size_t i = 0; i < count; ++i) {
+			const xdp_desc* const desc = rx.frame(rx.cached + i);
+			len[i] = desc->len;
+			frame[i] = vlan_strip(umem + desc->addr, len[i]);
+			rx_addr[i] = frame[i] - umem;
+		}
+
+		rx_taken = count;
+		return count;
+	}
+
+	void rx_release() {
+		// recycle the chunks to the fill ring; there is always room as the rx half of the umem is ours
+		for (size_t i = 0; i < rx_taken; ++i)
+			*fill.addr(fill.cached++) = rx.frame(rx.cached++)->addr;
+
+		fill.produce();
+		rx.consume();
+		rx_taken = 0;
+	}
+
+	// zero copy: the descriptors of the frames sent back move from the rx ring to the tx ring, those
+	// of the rest to the fill ring; a frame tagged goes out from the headroom of its chunk, if it came
+	// in untagged
+	bool rx_reflect(const size_t* index, const size_t n) {
+		for (;;) {
+			reclaim();
+
+			if (tx.free_entries() >= n)
+				break;
+
+			// tx ring full - have the kernel get on with it
+			if (!kick())
+				return false;
+
+			if (0 == comp.avail_entries() && !wait(POLLOUT, -1))
+				return false;
+		}
+
+		for (size_t i = 0, k = 0; i < rx_taken; ++i) {
+			const xdp_desc* const desc = rx.frame(rx.cached++);
+
+			if (k < n && index[k] == i) {
+				xdp_desc* const out = tx.frame(tx.cached++);
+
+				if (0 != tag_size)
+					vlan_insert(umem + rx_addr[i], tci);
+
+				out->addr = rx_addr[i] - tag_size;
+				out->len = frame_size + tag_size;
+				out->options = 0;
+				++k;
+			}
+			else
+				*fill.addr(fill.cached++) = desc->addr;
+		}
+
+		fill.produce();
+		rx.consume();
+		tx.produce();
+		rx_taken = 0;
+		tx_outstanding += n;
+
+		return 0 == n || kick();
+	}
+
+	// frames bypass the socket layer and its timestamping entirely
+	bool tx_timestamp(uint64_t&) {
+		return false;
+	}
+
+	bool rx_timestamp(const size_t, uint64_t&) {
+		return false;
+	}
+};
+
+#endif // engine_xdp_H__
@@ -0,0 +1,168 @@
+#ifndef histogram_H__
+#define histogram_H__
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+// HDR-style histogram of 64-bit values: each power of two is split in 2^precision_bits linear
+// sub-buckets, i.e. values are recorded to about 3 significant decimal digits; all storage is
+// fixed, so recording never allocates
+class histogram {
+	enum {
+		precision_bits = 10,
+		range_bits     = 40, // values at or above 2^range_bits get clamped to the top bucket
+		sub_count      = 1 << precision_bits,
+		bucket_count   = (range_bits - precision_bits + 1) * sub_count
+	};
+
+	uint64_t bucket[bucket_count];
+	uint64_t count;
+	uint64_t min;
+	uint64_t max;
+
+	static size_t index_of(uint64_t v) {
+		if (v >> range_bits)
+			v = (uint64_t(1) << range_bits) - 1;
+
+		if (v < sub_count)
+			return size_t(v);
+
+		const uint32_t shift = 63 - __builtin_clzll(v) - precision_bits;
+		return size_t(shift + 1) * sub_count + size_t(v >> shift) - sub_count;
+	}
+
+	// lowest and highest value of a bucket
+	static uint64_t lowest_of(const size_t i) {
+		if (i < sub_count)
+			return i;
+
+		const uint32_t shift = uint32_t(i / sub_count) - 1;
+		return (uint64_t(sub_count) + i % sub_count) << shift;
+	}
+
+	static uint64_t highest_of(const size_t i) {
+		if (i < sub_count)
+			return i;
+
+		const uint32_t shift = uint32_t(i / sub_count) - 1;
+		return lowest_of(i) + (uint64_t(1) << shift) - 1;
+	}
+
+public:
+	histogram() {
+		reset();
+	}
+
+	void reset() {
+		memset(bucket, 0, sizeof(bucket));
+		count = 0;
+		min = ~uint64_t(0);
+		max = 0;
+	}
+
+	void record(const uint64_t v) {
+		++bucket[index_of(v)];
+		++count;
+		min = v < min ? v : min;
+		max = v > max ? v : max;
+	}
+
+	void add(const histogram& other) {
+		for (size_t i = 0; i < bucket_count; ++i)
+			bucket[i] += other.bucket[i];
+
+		count += other.count;
+		min = other.min < min ? other.min : min;
+		max = other.max > max ? other.max : max;
+	}
+
+	uint64_t total() const {
+		return count;
+	}
+
+	uint64_t lowest() const {
+		return count ? min : 0;
+	}
+
+	uint64_t highest() const {
+		return max;
+	}
+
+	// value at the given percentile: the highest value equivalent to the bucket the rank falls in,
+	// capped by the maximum recorded
+	uint64_t percentile(const double p) const {
+		if (0 == count)
+			return 0;
+
+		uint64_t rank = uint64_t(p / 100.0 * double(count) + 0.5);
+		rank = rank ? rank : 1;
+
+		for (size_t i = 0, acc = 0; i < bucket_count; ++i) {
+			acc += bucket[i];
+
+			if (acc >= rank) {
+				const uint64_t v = highest_of(i);
+				return v < max ? v : max;
+			}
+		}
+
+		return max;
+	}
+
+	// write the percentile distribution in the text format of HdrHistogram, values scaled by 1/scale
+	void dump(FILE* const f, const double scale) const {
+		fprintf(f, "%12s %14s %10s %14s\n\n", "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+
+		for (size_t i = 0, acc = 0; i < bucket_count; ++i) {
+			if (0 == bucket[i])
+				continue;
+
+			acc += bucket[i];
+
+			const double fraction = double(acc) / double(count);
+			const uint64_t v = highest_of(i) < max ? highest_of(i) : max;
+
+			if (acc < count)
+				fprintf(f, "%12.3f %2.12f %10llu %14.2f\n", double(v) / scale, fraction, (unsigned long long) acc, 1.0 / (1.0 - fraction));
+			else
+				fprintf(f, "%12.3f %2.12f %10llu\n", double(v) / scale, fraction, (unsigned long long) acc);
+		}
+
+		fprintf(f, "#[Mean    = %12.3f, StdDeviation   = %12.3f]\n", mean() / scale, stddev() / scale);
+		fprintf(f, "#[Max     = %12.3f, Total count    = %12llu]\n", double(max) / scale, (unsigned long long) count);
+	}
+
+	double mean() const {
+		if (0 == count)
+			return 0.0;
+
+		double sum = 0.0;
+
+		for (size_t i = 0; i < bucket_count; ++i) {
+			if (bucket[i])
+				sum += double(bucket[i]) * (double(lowest_of(i)) + double(highest_of(i))) * 0.5;
+		}
+
+		return sum / double(count);
+	}
+
+	double stddev() const {
+		if (0 == count)
+			return 0.0;
+
+		const double m = mean();
+		double sum = 0.0;
+
+		for (size_t i = 0; i < bucket_count; ++i) {
+			if (bucket[i]) {
+				const double d = (double(lowest_of(i)) + double(highest_of(i))) * 0.5 - m;
+				sum += double(bucket[i]) * d * d;
+			}
+		}
+
+		return sqrt(sum / double(count));
+	}
+};
+
+#endif // histogram_H__
@@ -0,0 +1,198 @@
+#ifndef instrument_H__
+#define instrument_H__
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include "timer.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// hot-path instrumentation, compiled in only when building with -DBANDW_INSTRUMENT=1: a wrapper
+// engine times every engine call, in ns and cycles, and counts the frames it moves; the engines
+// count the syscall outcomes worth knowing about; all counters are per lane (thread), so counting
+// takes no atomics. The default build gets the bare engines and empty probes, i.e. pays nothing
+
+#ifndef BANDW_INSTRUMENT
+#define BANDW_INSTRUMENT 0
+#endif
+
+enum probe_call {
+	probe_tx_acquire,
+	probe_tx_commit,
+	probe_tx_flush,
+	probe_rx_acquire,
+	probe_rx_reflect,
+
+	probe_call_count
+};
+
+static const char* const probe_call_name[probe_call_count] = {
+	"tx_acquire",
+	"tx_commit",
+	"tx_flush",
+	"rx_acquire",
+	"rx_reflect"
+};
+
+enum probe_event {
+	probe_eagain,       // rx_acquire timed out
+	probe_short_write,  // a send took fewer frames or octets than offered
+	probe_tx_busy,      // a kick found the device queue full
+
+	probe_event_count
+};
+
+static const char* const probe_event_name[probe_event_count] = {
+	"eagain",
+	"short_writes",
+	"tx_busy"
+};
+
+struct probe_set {
+	uint64_t calls[probe_call_count];
+	uint64_t frames[probe_call_count];
+	uint64_t ns[probe_call_count];     // time spent in the calls
+	uint64_t cycles[probe_call_count];
+	uint64_t events[probe_event_count];
+	uint64_t span_cycles;              // cycles from lane start to end
+
+	void reset() {
+		memset(this, 0, sizeof(*this));
+	}
+
+	void add(const probe_set& other) {
+		for (size_t i = 0; i < probe_call_count; ++i) {
+			calls[i] += other.calls[i];
+			frames[i] += other.frames[i];
+			ns[i] += other.ns[i];
+			cycles[i] += other.cycles[i];
+		}
+
+		for (size_t i = 0; i < probe_event_count; ++i)
+			events[i] += other.events[i];
+
+		span_cycles += other.span_cycles;
+	}
+};
+
+// cycle counter: the TSC where there is one, ns otherwise
+static inline uint64_t probe_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+
+#else
+	return timer_ns();
+
+#endif
+}
+
+#if BANDW_INSTRUMENT
+static __thread probe_set probe_local;
+
+static inline void probe_event(const int e) {
+	++probe_local.events[e];
+}
+
+// lane: start counting afresh
+static inline void probe_begin() {
+	probe_local.reset();
+	probe_local.span_cycles = probe_cycles();
+}
+
+// lane: stop counting, hand the counts over
+static inline void probe_end(probe_set& to) {
+	to = probe_local;
+	to.span_cycles = probe_cycles() - probe_local.span_cycles;
+}
+
+// engine timing each call of the engine it wraps
+template < class ENGINE_T >
+class instrumented : public ENGINE_T {
+	struct stopwatch {
+		uint64_t ns;
+		uint64_t cycles;
+
+		stopwatch()
+		: ns(timer_ns())
+		, cycles(probe_cycles()) {
+		}
+
+		void stop(const int call, const size_t frames) const {
+			++probe_local.calls[call];
+			probe_local.frames[call] += frames;
+			probe_local.ns[call] += timer_ns() - ns;
+			probe_local.cycles[call] += probe_cycles() - cycles;
+		}
+	};
+
+public:
+	size_t tx_acquire(uint8_t** frame, const size_t n) {
+		const stopwatch sw;
+		const size_t count = ENGINE_T::tx_acquire(frame, n);
+		sw.stop(probe_tx_acquire, count);
+		return count;
+	}
+
+	bool tx_commit(const size_t n) {
+		const stopwatch sw;
+		const bool ok = ENGINE_T::tx_commit(n);
+		sw.stop(probe_tx_commit, n);
+		return ok;
+	}
+
+	bool tx_flush() {
+		const stopwatch sw;
+		const bool ok = ENGINE_T::tx_flush();
+		sw.stop(probe_tx_flush, 0);
+		return ok;
+	}
+
+	size_t rx_acquire(const uint8_t** frame, size_t* len, const size_t n) {
+		// through the wrapper the compiler cannot tell that the engine sets the frames it counts, and
+		// warns of the loops reading them; setting the first one, ahead of the stopwatch, settles it
+		frame[0] = 0;
+		len[0] = 0;
+
+		const stopwatch sw;
+		const size_t count = ENGINE_T::rx_acquire(frame, len, n);
+		const int err = errno;
+		sw.stop(probe_rx_acquire, count);
+
+		if (0 == count && (EAGAIN == err || EWOULDBLOCK == err))
+			probe_event(probe_eagain);
+
+		errno = err;
+		return count;
+	}
+
+	bool rx_reflect(const size_t* index, const size_t n) {
+		const stopwatch sw;
+		const bool ok = ENGINE_T::rx_reflect(index, n);
+		sw.stop(probe_rx_reflect, n);
+		return ok;
+	}
+};
+
+template < class ENGINE_T >
+struct probed {
+	typedef instrumented< ENGINE_T > type;
+};
+
+#else
+static inline void probe_event(const int) {
+}
+
+static inline void probe_begin() {
+}
+
+static inline void probe_end(probe_set&) {
+}
+
+template < class ENGINE_T >
+struct probed {
+	typedef ENGINE_T type;
+};
+
+#endif
+#endif // instrument_H__
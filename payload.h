@@ -0,0 +1,256 @@
+#ifndef payload_H__
+#define payload_H__
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <endian.h>
+#include <linux/if_ether.h>
+#include "wire.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif defined(__aarch64__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+// frame body past the test header: a pattern of the payload mode, optionally followed by a CRC32C
+// of the body in the last four octets of the frame; the body is the same for all frames but in
+// prng mode, where it derives from the sequence number, so there it gets written, and the trailer
+// computed, frame by frame
+
+enum payload_mode {
+	payload_inc,   // octet i of the frame set to i modulo 256
+	payload_zeros,
+	payload_prng,  // pseudo-random octets seeded by the sequence number
+
+	payload_mode_count
+};
+
+static const char* const payload_name[payload_mode_count] = {
+	"inc",
+	"zeros",
+	"prng"
+};
+
+static const size_t payload_offset = sizeof(wire_header); // start of the body in the payload
+static const size_t payload_trailer_size = sizeof(uint32_t);
+
+// CRC32C (Castagnoli), reflected, as of iSCSI and ext4; by the SSE4.2 or ARMv8 CRC instructions
+// where the core has them, by a slice-by-8 table otherwise
+class crc32c {
+	static uint32_t table[8][256];
+
+	static void init_table() {
+		for (uint32_t i = 0; i < 256; ++i) {
+			uint32_t c = i;
+
+			for (int k = 0; k < 8; ++k)
+				c = c & 1 ? c >> 1 ^ 0x82f63b78 : c >> 1;
+
+			table[0][i] = c;
+		}
+
+		for (uint32_t i = 0; i < 256; ++i) {
+			for (int t = 1; t < 8; ++t)
+				table[t][i] = table[t - 1][i] >> 8 ^ table[0][table[t - 1][i] & 0xff];
+		}
+	}
+
+	static uint32_t soft(
+		uint32_t c,
+		const uint8_t* p,
+		size_t len) {
+
+		for (; len >= 8; p += 8, len -= 8) {
+			uint64_t v;
+			memcpy(&v, p, sizeof(v));
+			v = le64toh(v) ^ c;
+
+			c = table[7][v & 0xff] ^ table[6][v >> 8 & 0xff] ^ table[5][v >> 16 & 0xff] ^ table[4][v >> 24 & 0xff] ^
+				table[3][v >> 32 & 0xff] ^ table[2][v >> 40 & 0xff] ^ table[1][v >> 48 & 0xff] ^ table[0][v >> 56];
+		}
+
+		for (; 0 != len; ++p, --len)
+			c = table[0][(c ^ *p) & 0xff] ^ c >> 8;
+
+		return c;
+	}
+
+#if defined(__x86_64__)
+	__attribute__ ((target("sse4.2")))
+	static uint32_t hard(
+		uint32_t c,
+		const uint8_t* p,
+		size_t len) {
+
+		uint64_t c64 = c;
+
+		for (; len >= 8; p += 8, len -= 8) {
+			uint64_t v;
+			memcpy(&v, p, sizeof(v));
+			c64 = _mm_crc32_u64(c64, v);
+		}
+
+		c = uint32_t(c64);
+
+		for (; 0 != len; ++p, --len)
+			c = _mm_crc32_u8(c, *p);
+
+		return c;
+	}
+
+	static bool hard_available() {
+		return __builtin_cpu_supports("sse4.2");
+	}
+
+#elif defined(__aarch64__)
+	__attribute__ ((target("+crc")))
+	static uint32_t hard(
+		uint32_t c,
+		const uint8_t* p,
+		size_t len) {
+
+		for (; len >= 8; p += 8, len -= 8) {
+			uint64_t v;
+			memcpy(&v, p, sizeof(v));
+			c = __crc32cd(c, v);
+		}
+
+		for (; 0 != len; ++p, --len)
+			c = __crc32cb(c, *p);
+
+		return c;
+	}
+
+	static bool hard_available() {
+		return 0 != (getauxval(AT_HWCAP) & HWCAP_CRC32);
+	}
+
+#else
+	static uint32_t hard(
+		uint32_t c,
+		const uint8_t* p,
+		size_t len) {
+
+		return soft(c, p, len);
+	}
+
+	static bool hard_available() {
+		return false;
+	}
+
+#endif
+	typedef uint32_t (*kernel_t)(uint32_t, const uint8_t*, size_t);
+	static kernel_t kernel;
+
+public:
+	// pick the kernel; ahead of the first use, on one thread
+	static void init() {
+		init_table();
+		kernel = hard_available() ? hard : soft;
+	}
+
+	static bool hardware() {
+		return kernel != soft;
+	}
+
+	static uint32_t of(
+		const uint8_t* const p,
+		const size_t len) {
+
+		return ~kernel(~0U, p, len);
+	}
+};
+
+uint32_t crc32c::table[8][256];
+crc32c::kernel_t crc32c::kernel = crc32c::soft;
+
+// generator of the body of prng mode: splitmix64, seeded by the sequence number
+static inline uint64_t payload_mix(uint64_t& state) {
+	uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ z >> 30) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ z >> 27) * 0x94d049bb133111ebULL;
+	return z ^ z >> 31;
+}
+
+struct payload_spec {
+	int mode;        // payload_mode
+	bool verify;     // frames carry a CRC32C trailer, checked on receipt
+	size_t body_len; // octets from past the test header up to the trailer, or the end of the frame
+
+	void init(
+		const int payload_mode,
+		const bool payload_verify,
+		const size_t frame_size) { // frame size, eth header included
+
+		mode = payload_mode;
+		verify = payload_verify;
+		body_len = frame_size - ETH_HLEN - payload_offset - (verify ? payload_trailer_size : 0);
+	}
+
+	// template frame: fill in the body, and the trailer thereof, common to all frames but in prng
+	// mode; payload starts past the eth header
+	void fill(uint8_t* const payload) const {
+		uint8_t* const body = payload + payload_offset;
+
+		if (payload_prng == mode) {
+			stamp(payload, 0);
+			return;
+		}
+
+		if (payload_zeros == mode)
+			memset(body, 0, body_len);
+		else {
+			for (size_t i = 0; i < body_len; ++i)
+				body[i] = uint8_t(ETH_HLEN + payload_offset + i);
+		}
+
+		if (verify)
+			seal(payload);
+	}
+
+	// per frame: nothing but in prng mode, where the body derives from the sequence number
+	void stamp(
+		uint8_t* const payload,
+		const uint64_t seq) const {
+
+		if (payload_prng != mode)
+			return;
+
+		uint8_t* const body = payload + payload_offset;
+		uint64_t state = seq;
+		size_t i = 0;
+
+		for (; i + 8 <= body_len; i += 8) {
+			const uint64_t v = payload_mix(state);
+			memcpy(body + i, &v, sizeof(v));
+		}
+
+		if (i < body_len) {
+			const uint64_t v = payload_mix(state);
+			memcpy(body + i, &v, body_len - i);
+		}
+
+		if (verify)
+			seal(payload);
+	}
+
+	// write the trailer over the body
+	void seal(uint8_t* const payload) const {
+		const uint32_t crc = htobe32(crc32c::of(payload + payload_offset, body_len));
+		memcpy(payload + payload_offset + body_len, &crc, sizeof(crc));
+	}
+
+	// tell whether the body of a frame received matches its trailer; true if not verifying
+	bool intact(const uint8_t* const payload) const {
+		if (!verify)
+			return true;
+
+		uint32_t crc;
+		memcpy(&crc, payload + payload_offset + body_len, sizeof(crc));
+		return be32toh(crc) == crc32c::of(payload + payload_offset, body_len);
+	}
+};
+
+#endif // payload_H__
@@ -0,0 +1,276 @@
+#ifndef perf_H__
+#define perf_H__
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+// system figures around the timed region: perf_event counters of each lane (thread), kernel and
+// user space alike where perf_event_paranoid permits, user space only otherwise; and snapshots of
+// the interrupt counts of the test iface and of the softirq backlog figures, system-wide, from
+// before and after the run
+
+enum perf_counter {
+	perf_cycles,
+	perf_instructions,
+	perf_llc_misses,
+	perf_context_switches,
+	perf_page_faults,
+
+	perf_counter_count
+};
+
+static const char* const perf_counter_name[perf_counter_count] = {
+	"cycles",
+	"instructions",
+	"llc misses",
+	"context switches",
+	"page faults"
+};
+
+static void perf_attr(
+	perf_event_attr& attr,
+	const int counter,
+	const bool user_only) {
+
+	static const uint32_t type[perf_counter_count] = {
+		PERF_TYPE_HARDWARE,
+		PERF_TYPE_HARDWARE,
+		PERF_TYPE_HW_CACHE,
+		PERF_TYPE_SOFTWARE,
+		PERF_TYPE_SOFTWARE
+	};
+	static const uint64_t config[perf_counter_count] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_LL | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16,
+		PERF_COUNT_SW_CONTEXT_SWITCHES,
+		PERF_COUNT_SW_PAGE_FAULTS
+	};
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type[counter];
+	attr.config = config[counter];
+	attr.disabled = 1;
+	attr.exclude_hv = 1;
+	attr.exclude_kernel = user_only ? 1 : 0;
+}
+
+// counter of the calling thread, -1 if not available
+static int perf_open(
+	const int counter,
+	const bool user_only) {
+
+	perf_event_attr attr;
+	perf_attr(attr, counter, user_only);
+
+	return int(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+// counters of a lane; the counters to open are found out ahead of the run, by perf_probe
+struct perf_set {
+	int fd[perf_counter_count];
+	uint64_t value[perf_counter_count];
+
+	// open and start the available counters on the calling thread
+	void begin(
+		const uint32_t mask,    // counters available
+		const bool user_only) { // counting restricted to user space
+
+		for (int i = 0; i < perf_counter_count; ++i) {
+			value[i] = 0;
+			fd[i] = mask & 1U << i ? perf_open(i, user_only) : -1;
+
+			if (0 <= fd[i])
+				ioctl(fd[i], PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+
+	// stop the counters and take their values
+	void end() {
+		for (int i = 0; i < perf_counter_count; ++i) {
+			if (0 > fd[i])
+				continue;
+
+			ioctl(fd[i], PERF_EVENT_IOC_DISABLE, 0);
+
+			if (sizeof(value[i]) != read(fd[i], &value[i], sizeof(value[i])))
+				value[i] = 0;
+
+			close(fd[i]);
+			fd[i] = -1;
+		}
+	}
+};
+
+// find out which counters the system lets us open, kernel included or not; warn about the rest;
+// return the mask of the counters available
+static uint32_t perf_probe(
+	bool& user_only) { // output: counting restricted to user space
+
+	uint32_t mask = 0;
+	user_only = false;
+
+	for (int pass = 0; pass < 2 && 0 == mask; ++pass) {
+		user_only = 0 != pass;
+
+		for (int i = 0; i < perf_counter_count; ++i) {
+			const int fd = perf_open(i, user_only);
+
+			if (0 <= fd) {
+				mask |= 1U << i;
+				close(fd);
+			}
+		}
+	}
+
+	if (0 == mask) {
+		fprintf(stderr, "warning: no perf counters available (errno: %s)\n", strerror(errno));
+		return 0;
+	}
+
+	for (int i = 0; i < perf_counter_count; ++i) {
+		if (!(mask & 1U << i))
+			fprintf(stderr, "warning: no perf counter of %s\n", perf_counter_name[i]);
+	}
+
+	if (user_only)
+		fprintf(stderr, "warning: perf counters restricted to user space\n");
+
+	return mask;
+}
+
+// interrupt counts of the iface, summed over all cpus, by irq; the irqs of an iface are those whose
+// /proc/interrupts description mentions the iface name
+struct irq_snapshot {
+	enum {
+		irq_max = 64
+	};
+
+	char irq[irq_max][16]; // irq number or name, as in the first column, up to 15 characters
+	uint64_t count[irq_max];
+	uint32_t irq_count;
+
+	// tell whether the text mentions the iface, by name not followed by more of a name, e.g.
+	// eth1-TxRx-0 but not eth10
+	static bool mentions(
+		const char* text,
+		const char* const iface_name) {
+
+		const size_t len = strlen(iface_name);
+
+		while (0 != (text = strstr(text, iface_name))) {
+			const char c = text[len];
+
+			if (!(('0' <= c && '9' >= c) || ('a' <= c && 'z' >= c) || ('A' <= c && 'Z' >= c)))
+				return true;
+
+			++text;
+		}
+
+		return false;
+	}
+
+	bool take(const char* const iface_name) {
+		irq_count = 0;
+
+		FILE* const f = fopen("/proc/interrupts", "r");
+
+		if (0 == f)
+			return false;
+
+		char line[4096];
+
+		// skip the header of cpu columns
+		if (0 == fgets(line, sizeof(line), f)) {
+			fclose(f);
+			return false;
+		}
+
+		while (irq_count < irq_max && 0 != fgets(line, sizeof(line), f)) {
+			char* colon = strchr(line, ':');
+
+			if (0 == colon || !mentions(colon, iface_name))
+				continue;
+
+			*colon = '\0';
+
+			const char* name = line;
+
+			while (' ' == *name)
+				++name;
+
+			uint64_t sum = 0;
+			char* p = colon + 1;
+
+			for (;;) {
+				char* end;
+				const unsigned long long n = strtoull(p, &end, 10);
+
+				if (end == p)
+					break;
+
+				sum += n;
+				p = end;
+			}
+
+			snprintf(irq[irq_count], sizeof(irq[irq_count]), "%.15s", name);
+			count[irq_count] = sum;
+			++irq_count;
+		}
+
+		fclose(f);
+		return true;
+	}
+
+	// count of the specified irq, 0 if not in the snapshot
+	uint64_t count_of(const char* const name) const {
+		for (uint32_t i = 0; i < irq_count; ++i) {
+			if (!strcmp(irq[i], name))
+				return count[i];
+		}
+
+		return 0;
+	}
+};
+
+// softirq backlog figures of /proc/net/softnet_stat, summed over all cpus; those are not per iface
+struct softnet_snapshot {
+	uint64_t processed;    // frames processed
+	uint64_t dropped;      // frames dropped for a full backlog
+	uint64_t time_squeeze; // net_rx_action runs cut short by the budget
+
+	bool take() {
+		processed = 0;
+		dropped = 0;
+		time_squeeze = 0;
+
+		FILE* const f = fopen("/proc/net/softnet_stat", "r");
+
+		if (0 == f)
+			return false;
+
+		unsigned int v[3];
+		char line[1024];
+
+		while (0 != fgets(line, sizeof(line), f)) {
+			if (3 != sscanf(line, "%x %x %x", &v[0], &v[1], &v[2]))
+				continue;
+
+			processed += v[0];
+			dropped += v[1];
+			time_squeeze += v[2];
+		}
+
+		fclose(f);
+		return true;
+	}
+};
+
+#endif // perf_H__
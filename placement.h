@@ -0,0 +1,270 @@
+#ifndef placement_H__
+#define placement_H__
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include "perf.h"
+
+// placement of the work on the host: real-time scheduling of the lanes, and steering of the irqs of
+// the test iface to a core of choice via /proc/irq/N/smp_affinity, the affinities of old restored
+// when done, or on SIGINT, SIGTERM and SIGHUP; both read back for the record, as the kernel may have
+// had other ideas
+
+// have the calling thread scheduled SCHED_FIFO at the specified priority, 0 for no change; return 0,
+// or the error number
+static int set_rt_priority(const int priority) {
+	if (0 == priority)
+		return 0;
+
+	sched_param param;
+	memset(&param, 0, sizeof(param));
+	param.sched_priority = priority;
+
+	return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+}
+
+// the scheduling of the calling thread as in effect: SCHED_FIFO priority, 0 for a regular policy
+static int rt_priority_of_self() {
+	int policy = SCHED_OTHER;
+	sched_param param;
+
+	if (0 != pthread_getschedparam(pthread_self(), &policy, &param) || (SCHED_FIFO != policy && SCHED_RR != policy))
+		return 0;
+
+	return param.sched_priority;
+}
+
+class irq_steering {
+	enum {
+		irq_max = 64
+	};
+
+	uint32_t irq[irq_max];
+	char saved[irq_max][320]; // smp_affinity of old, as read; empty if not steered
+	uint32_t irq_count;
+
+	// read the first line of a file, newline stripped
+	static bool read_line(
+		const char* const path,
+		char* const s,
+		const size_t size) {
+
+		FILE* const f = fopen(path, "r");
+
+		if (0 == f)
+			return false;
+
+		const bool ok = 0 != fgets(s, int(size), f);
+		fclose(f);
+
+		if (ok)
+			s[strcspn(s, "\n")] = '\0';
+
+		return ok;
+	}
+
+	// write a line to a file; by plain syscalls, for the signal handler to restore with
+	static bool write_line(
+		const char* const path,
+		const char* const s) {
+
+		const int fd = open(path, O_WRONLY | O_TRUNC | O_CLOEXEC);
+
+		if (0 > fd)
+			return false;
+
+		char line[sizeof(saved[0]) + 1];
+		const size_t len = strlen(s);
+
+		memcpy(line, s, len);
+		line[len] = '\n';
+
+		const bool ok = ssize_t(len + 1) == write(fd, line, len + 1);
+		return 0 == close(fd) && ok;
+	}
+
+	static irq_steering*& active() {
+		static irq_steering* steering = 0; // with affinities to restore, for the signal handler
+		return steering;
+	}
+
+	// put the affinities of old back on the signals that end bandw, then end it as the signal would
+	static void on_signal(const int sig) {
+		if (0 != active())
+			active()->restore(false);
+
+		signal(sig, SIG_DFL);
+		raise(sig);
+	}
+
+	void arm() {
+		if (0 != active())
+			return;
+
+		struct sigaction sa;
+		memset(&sa, 0, sizeof(sa));
+		sa.sa_handler = on_signal;
+		sigemptyset(&sa.sa_mask);
+		active() = this;
+
+		sigaction(SIGINT, &sa, 0);
+		sigaction(SIGTERM, &sa, 0);
+		sigaction(SIGHUP, &sa, 0);
+	}
+
+	void add(const uint32_t n) {
+		for (uint32_t i = 0; i < irq_count; ++i) {
+			if (irq[i] == n)
+				return;
+		}
+
+		if (irq_max > irq_count)
+			irq[irq_count++] = n;
+	}
+
+	// irqs of a device directory, from its msi_irqs listing
+	void add_msi(const char* const device) {
+		char path[256];
+		snprintf(path, sizeof(path), "%s/msi_irqs", device);
+
+		DIR* const dir = opendir(path);
+
+		if (0 == dir)
+			return;
+
+		for (const dirent* e; 0 != (e = readdir(dir));) {
+			uint32_t n = 0;
+
+			if (1 == sscanf(e->d_name, "%u", &n))
+				add(n);
+		}
+
+		closedir(dir);
+	}
+
+public:
+	irq_steering()
+	: irq_count(0) {
+	}
+
+	~irq_steering() {
+		restore();
+	}
+
+	// find the irqs of the iface: the MSI vectors of its device, or of the parent device the iface
+	// sits on, e.g. for virtio; failing those, the irqs whose /proc/interrupts description names it
+	bool find(const char* const iface_name) {
+		char device[128];
+		snprintf(device, sizeof(device), "/sys/class/net/%s/device", iface_name);
+
+		add_msi(device);
+
+		if (0 == irq_count) {
+			char parent[160];
+			snprintf(parent, sizeof(parent), "%s/..", device);
+			add_msi(parent);
+		}
+
+		if (0 == irq_count) {
+			irq_snapshot snap;
+
+			if (snap.take(iface_name)) {
+				for (uint32_t i = 0; i < snap.irq_count; ++i) {
+					uint32_t n = 0;
+
+					if (1 == sscanf(snap.irq[i], "%u", &n))
+						add(n);
+				}
+			}
+		}
+
+		for (uint32_t i = 0; i < irq_count; ++i)
+			saved[i][0] = '\0';
+
+		return 0 != irq_count;
+	}
+
+	// steer all irqs found to the specified core; those the kernel will not have moved, e.g. managed
+	// ones, stay put, with a warning; false if none could be steered
+	bool steer(const int cpu) {
+		// the hex mask of the core, in comma-separated groups of 32 bits, as smp_affinity takes it
+		char mask[320] = "";
+
+		for (int g = cpu / 32, len = 0; 0 <= g; --g)
+			len += snprintf(mask + len, sizeof(mask) - len, "%s%08x", cpu / 32 == g ? "" : ",", cpu / 32 == g ? 1U << cpu % 32 : 0U);
+
+		uint32_t steered = 0;
+		arm();
+
+		for (uint32_t i = 0; i < irq_count; ++i) {
+			char path[64];
+			snprintf(path, sizeof(path), "/proc/irq/%u/smp_affinity", irq[i]);
+
+			char old[sizeof(saved[i])];
+
+			if (!read_line(path, old, sizeof(old)) || !write_line(path, mask)) {
+				fprintf(stderr, "warning: cannot steer irq %u to cpu %d (errno: %s)\n", irq[i], cpu, strerror(errno));
+				continue;
+			}
+
+			memcpy(saved[i], old, sizeof(old));
+			++steered;
+		}
+
+		return 0 != steered;
+	}
+
+	// put the affinities of old back, warning of those that will not go back unless quiet, as in the
+	// signal handler
+	void restore(const bool report = true) {
+		for (uint32_t i = 0; i < irq_count; ++i) {
+			if ('\0' == saved[i][0])
+				continue;
+
+			char path[64];
+			snprintf(path, sizeof(path), "/proc/irq/%u/smp_affinity", irq[i]);
+
+			if (!write_line(path, saved[i]) && report)
+				fprintf(stderr, "warning: cannot restore the affinity of irq %u (errno: %s)\n", irq[i], strerror(errno));
+
+			saved[i][0] = '\0';
+		}
+
+		if (this == active())
+			active() = 0;
+	}
+
+	// the irqs and the cores each is taken on, as in effect, e.g. "34:2 35:2", into s
+	void describe(
+		char* const s,
+		const size_t size) const {
+
+		size_t len = 0;
+		s[0] = '\0';
+
+		for (uint32_t i = 0; i < irq_count && len < size; ++i) {
+			char path[64];
+			char cpus[128];
+
+			snprintf(path, sizeof(path), "/proc/irq/%u/effective_affinity_list", irq[i]);
+
+			if (!read_line(path, cpus, sizeof(cpus))) {
+				snprintf(path, sizeof(path), "/proc/irq/%u/smp_affinity_list", irq[i]);
+
+				if (!read_line(path, cpus, sizeof(cpus)))
+					snprintf(cpus, sizeof(cpus), "?");
+			}
+
+			len += snprintf(s + len, size - len, "%s%u:%s", 0 == i ? "" : " ", irq[i], cpus);
+		}
+	}
+};
+
+#endif // placement_H__
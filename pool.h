@@ -0,0 +1,194 @@
+#ifndef pool_H__
+#define pool_H__
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// frame memory of a worker: an arena of frame slots a cache line apart, mapped up front and handed
+// out once, during setup, so that nothing gets allocated in the hot path; the arena may be backed
+// by hugepages, and gets bound to the NUMA node of the worker's core before it is first touched
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+
+static const size_t cache_line_size = 64;
+static const size_t hugepage_size = 2 << 20;
+
+// NUMA node of the specified core, -1 if unknown
+static int cpu_node(const int cpu) {
+	if (0 > cpu)
+		return -1;
+
+	char path[64];
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+
+	DIR* const dir = opendir(path);
+
+	if (0 == dir)
+		return -1;
+
+	int node = -1;
+
+	for (const dirent* e; -1 == node && 0 != (e = readdir(dir));) {
+		if (1 != sscanf(e->d_name, "node%d", &node))
+			node = -1;
+	}
+
+	closedir(dir);
+	return node;
+}
+
+// map an anonymous region, from hugepages if so requested and any are to be had, from regular pages
+// with transparent hugepages advised otherwise; size is rounded up to the page size used
+static uint8_t* map_region(
+	size_t& size, // input: octets wanted; output: octets mapped
+	const bool huge) {
+
+	if (huge) {
+		const size_t huge_size = (size + hugepage_size - 1) & ~(hugepage_size - 1);
+		void* const p = mmap(0, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+		if (MAP_FAILED != p) {
+			size = huge_size;
+			return reinterpret_cast< uint8_t* >(p);
+		}
+
+		static bool warned = false;
+
+		if (!warned) {
+			fprintf(stderr, "warning: no hugepages to be had, using regular pages (errno: %s)\n", strerror(errno));
+			warned = true;
+		}
+	}
+
+	const size_t page_size = size_t(sysconf(_SC_PAGESIZE));
+	size = (size + page_size - 1) & ~(page_size - 1);
+
+	void* const p = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (MAP_FAILED == p)
+		return 0;
+
+	if (huge)
+		madvise(p, size, MADV_HUGEPAGE);
+
+	return reinterpret_cast< uint8_t* >(p);
+}
+
+// have the pages of a region come from the specified NUMA node, where possible; -1 for no preference
+static void bind_region(
+	uint8_t* const base,
+	const size_t size,
+	const int node) {
+
+	if (0 > node || 8 * int(sizeof(unsigned long)) <= node)
+		return;
+
+	const unsigned long mask = 1UL << node;
+
+	if (0 > syscall(__NR_mbind, base, size, MPOL_PREFERRED, &mask, 8 * sizeof(mask), 0)) {
+		static bool warned = false;
+
+		if (!warned) {
+			fprintf(stderr, "warning: cannot bind frame memory to numa node %d (errno: %s)\n", node, strerror(errno));
+			warned = true;
+		}
+	}
+}
+
+class frame_pool {
+	uint8_t* base;
+	size_t size;      // octets mapped
+	size_t slot_size; // frame size rounded up to a cache line
+	size_t slot_nr;
+	size_t taken;     // slots handed out
+	bool huge;
+	int node;
+
+public:
+	frame_pool()
+	: base(0)
+	, size(0)
+	, slot_size(0)
+	, slot_nr(0)
+	, taken(0)
+	, huge(false)
+	, node(-1) {
+	}
+
+	~frame_pool() {
+		if (0 != base)
+			munmap(base, size);
+	}
+
+	bool init(
+		const size_t slots,      // slots in the arena
+		const size_t frame_size, // largest frame a slot takes
+		const bool hugepages,    // hugepage backing wanted
+		const int numa_node) {   // NUMA node to allocate on, -1 for no preference
+
+		huge = hugepages;
+		node = numa_node;
+		slot_size = (frame_size + cache_line_size - 1) & ~(cache_line_size - 1);
+		slot_nr = slots;
+		size = slot_size * slot_nr;
+		base = map_region(size, huge);
+
+		if (0 == base) {
+			size = 0;
+			fprintf(stderr, "error: cannot map frame pool (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		bind_region(base, size, node);
+
+		// first touch: this is where the pages get allocated; all slots start out with the same
+		// payload pattern, octet i of a slot set to i
+		for (size_t i = 0; i < slot_nr; ++i) {
+			uint8_t* const s = base + i * slot_size;
+
+			for (size_t j = 0; j < slot_size; ++j)
+				s[j] = uint8_t(j);
+		}
+
+		return true;
+	}
+
+	// map a region apart from the arena, backed and bound alike, and touch it; for engines wanting
+	// memory of a layout of their own, to unmap it when done
+	uint8_t* map(size_t& octets) const { // input: octets wanted; output: octets mapped
+		uint8_t* const p = map_region(octets, huge);
+
+		if (0 == p)
+			return 0;
+
+		bind_region(p, octets, node);
+		memset(p, 0, octets);
+		return p;
+	}
+
+	// distance of one slot from the next, octets
+	size_t stride() const {
+		return slot_size;
+	}
+
+	// hand out the specified count of consecutive slots, a stride apart; 0 if the pool is exhausted
+	uint8_t* take(const size_t n) {
+		if (slot_nr - taken < n) {
+			fprintf(stderr, "error: frame pool exhausted\n");
+			return 0;
+		}
+
+		uint8_t* const s = base + taken * slot_size;
+		taken += n;
+		return s;
+	}
+};
+
+#endif // pool_H__
@@ -0,0 +1,226 @@
+#ifndef report_H__
+#define report_H__
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// machine-readable results: a record per result - thread, soak interval or run - as one line of JSON
+// or one row of CSV, each record carrying the run metadata along with its figures; CSV rows get a
+// header row ahead of them whenever the columns change. In text format records are not kept, and
+// results go out as the human-readable lines of old
+
+enum report_format {
+	report_text,
+	report_json,
+	report_csv,
+
+	report_format_count
+};
+
+static const char* const report_format_name[report_format_count] = {
+	"text",
+	"json",
+	"csv"
+};
+
+class report {
+	enum {
+		line_size = 8192
+	};
+
+	int format;
+	size_t count;           // fields in the current record
+	char keys[line_size];   // csv: header of the current record
+	char values[line_size]; // values of the current record; json: the whole record
+	char header[line_size]; // csv: last header row written
+	size_t keys_len;
+	size_t values_len;
+
+	void append(char* const buf, size_t& len, const char* const s) {
+		const size_t n = strlen(s);
+
+		if (len + n < line_size) {
+			memcpy(buf + len, s, n + 1);
+			len += n;
+		}
+	}
+
+	// start a field; keys are the prefix and name, with spaces turned to underscores
+	void key(
+		const char* const prefix,
+		const char* const name) {
+
+		char k[128];
+		snprintf(k, sizeof(k), "%s%s", prefix, name);
+
+		for (char* c = k; '\0' != *c; ++c)
+			*c = ' ' == *c ? '_' : *c;
+
+		if (report_json == format) {
+			append(values, values_len, count ? ",\"" : "\"");
+			append(values, values_len, k);
+			append(values, values_len, "\":");
+		}
+		else {
+			append(keys, keys_len, count ? "," : "");
+			append(keys, keys_len, k);
+			append(values, values_len, count ? "," : "");
+		}
+
+		++count;
+	}
+
+public:
+	report(const int format)
+	: format(format)
+	, count(0)
+	, keys_len(0)
+	, values_len(0) {
+		keys[0] = '\0';
+		values[0] = '\0';
+		header[0] = '\0';
+	}
+
+	// human-readable output wanted
+	bool text() const {
+		return report_text == format;
+	}
+
+	// stream for the progress lines around the results: stdout in text format, stderr otherwise,
+	// leaving stdout to the records
+	FILE* info() const {
+		return text() ? stdout : stderr;
+	}
+
+	void begin(const char* const kind) {
+		count = 0;
+		keys_len = 0;
+		values_len = 0;
+		keys[0] = '\0';
+		values[0] = '\0';
+
+		if (report_json == format)
+			append(values, values_len, "{");
+
+		str("record", kind);
+	}
+
+	void str(
+		const char* const name,
+		const char* const v) {
+
+		if (text())
+			return;
+
+		key("", name);
+
+		char q[256];
+		size_t n = 0;
+
+		// quote for either format; the strings at hand are names and addresses, nothing longer
+		q[n++] = '"';
+
+		for (const char* c = v; '\0' != *c && n < sizeof(q) - 3; ++c) {
+			if ('"' == *c || (report_json == format && '\\' == *c))
+				q[n++] = report_json == format ? '\\' : '"';
+
+			q[n++] = uint8_t(*c) < 0x20 ? ' ' : *c;
+		}
+
+		q[n++] = '"';
+		q[n] = '\0';
+		append(values, values_len, q);
+	}
+
+	void u64(
+		const char* const prefix,
+		const char* const name,
+		const uint64_t v) {
+
+		if (text())
+			return;
+
+		key(prefix, name);
+
+		char s[32];
+		snprintf(s, sizeof(s), "%llu", (unsigned long long) v);
+		append(values, values_len, s);
+	}
+
+	void u64(
+		const char* const name,
+		const uint64_t v) {
+
+		u64("", name, v);
+	}
+
+	void i64(
+		const char* const name,
+		const int64_t v) {
+
+		if (text())
+			return;
+
+		key("", name);
+
+		char s[32];
+		snprintf(s, sizeof(s), "%lld", (long long) v);
+		append(values, values_len, s);
+	}
+
+	void f64(
+		const char* const prefix,
+		const char* const name,
+		const double v) {
+
+		if (text())
+			return;
+
+		key(prefix, name);
+
+		char s[64];
+		snprintf(s, sizeof(s), "%.6f", v);
+		append(values, values_len, s);
+	}
+
+	void f64(
+		const char* const name,
+		const double v) {
+
+		f64("", name, v);
+	}
+
+	void flag(
+		const char* const name,
+		const bool v) {
+
+		if (text())
+			return;
+
+		key("", name);
+		append(values, values_len, report_json == format ? (v ? "true" : "false") : (v ? "1" : "0"));
+	}
+
+	// write the record out
+	void end() {
+		if (text())
+			return;
+
+		if (report_json == format) {
+			append(values, values_len, "}");
+			printf("%s\n", values);
+		}
+		else {
+			if (strcmp(header, keys)) {
+				memcpy(header, keys, keys_len + 1);
+				printf("%s\n", header);
+			}
+
+			printf("%s\n", values);
+		}
+
+		fflush(stdout);
+	}
+};
+
+#endif // report_H__
@@ -0,0 +1,189 @@
+#ifndef soak_H__
+#define soak_H__
+#include <stdint.h>
+#include <string.h>
+#include <sched.h>
+#include "histogram.h"
+
+// soak mode: the transmitter streams for a set duration and reports the figures of every interval
+// while streaming; the lanes never wait for the reporter - all figures a lane keeps are written by
+// the lane alone and published with atomic stores, and the reporter picks them up, and does the
+// arithmetic, on a thread of its own
+
+// tracker of the frames received of an endless sequence: a bitmap over a window of the most recent
+// sequence numbers tells the frames received already; frames older than the window are counted as
+// late and skipped, frames not received by the time the sequence has moved past them as lost
+class seq_window {
+	enum {
+		window_bits = 1 << 16 // reordering depth, frames
+	};
+
+	uint64_t seen[window_bits / 64];
+
+public:
+	uint64_t top;       // one past the highest frame received
+	uint64_t received;  // distinct frames
+	uint64_t duplicate; // frames received more than once
+	uint64_t reordered; // frames received after a higher one
+	uint64_t late;      // frames received after the window has moved past them
+	uint64_t foreign;   // frames not of the test
+	uint64_t corrupt;   // frames of the test whose body failed verification, skipped
+
+	seq_window() {
+		reset();
+	}
+
+	void reset() {
+		memset(seen, 0, sizeof(seen));
+		top = 0;
+		received = 0;
+		duplicate = 0;
+		reordered = 0;
+		late = 0;
+		foreign = 0;
+		corrupt = 0;
+	}
+
+	// account for a frame of the test; return whether it is a frame not received before
+	bool accept(const uint64_t seq) {
+		if (seq + window_bits <= top) {
+			++late;
+			return false;
+		}
+
+		// move the window up, clearing the slots of the frames it moves past
+		if (seq >= top) {
+			if (seq - top >= window_bits)
+				memset(seen, 0, sizeof(seen));
+			else {
+				for (uint64_t s = top; s <= seq; ++s)
+					seen[s % window_bits / 64] &= ~(uint64_t(1) << s % 64);
+			}
+		}
+
+		uint64_t& word = seen[seq % window_bits / 64];
+		const uint64_t bit = uint64_t(1) << seq % 64;
+
+		if (word & bit) {
+			++duplicate;
+			return false;
+		}
+
+		word |= bit;
+		++received;
+
+		if (seq < top)
+			++reordered;
+		else
+			top = seq + 1;
+
+		return true;
+	}
+
+	// account for a frame not of the test
+	void reject() {
+		++foreign;
+	}
+
+	// account for a frame of the test with a corrupt body
+	void damaged() {
+		++corrupt;
+	}
+
+	// an endless sequence is never done
+	bool done() const {
+		return false;
+	}
+
+	// frames the sequence has moved past without them arriving
+	uint64_t lost() const {
+		return top - received;
+	}
+};
+
+// figures of a receiving soak lane, cumulative; on a cache line of their own, away from those the
+// lane writes in the hot path
+struct __attribute__ ((aligned(64))) soak_counters {
+	uint64_t top;
+	uint64_t received;
+	uint64_t duplicate;
+	uint64_t reordered;
+	uint64_t late;
+	uint64_t foreign;
+	uint64_t corrupt;
+
+	// publish the figures of the window, once per batch
+	void publish(const seq_window& w) {
+		__atomic_store_n(&top, w.top, __ATOMIC_RELAXED);
+		__atomic_store_n(&received, w.received, __ATOMIC_RELAXED);
+		__atomic_store_n(&duplicate, w.duplicate, __ATOMIC_RELAXED);
+		__atomic_store_n(&reordered, w.reordered, __ATOMIC_RELAXED);
+		__atomic_store_n(&late, w.late, __ATOMIC_RELAXED);
+		__atomic_store_n(&foreign, w.foreign, __ATOMIC_RELAXED);
+		__atomic_store_n(&corrupt, w.corrupt, __ATOMIC_RELAXED);
+	}
+
+	// take a snapshot of the figures published so far
+	void load(seq_window& w) const {
+		w.top = __atomic_load_n(&top, __ATOMIC_RELAXED);
+		w.received = __atomic_load_n(&received, __ATOMIC_RELAXED);
+		w.duplicate = __atomic_load_n(&duplicate, __ATOMIC_RELAXED);
+		w.reordered = __atomic_load_n(&reordered, __ATOMIC_RELAXED);
+		w.late = __atomic_load_n(&late, __ATOMIC_RELAXED);
+		w.foreign = __atomic_load_n(&foreign, __ATOMIC_RELAXED);
+		w.corrupt = __atomic_load_n(&corrupt, __ATOMIC_RELAXED);
+	}
+};
+
+// round-trip times of a receiving soak lane, double-buffered: the lane records to the histogram of
+// the current epoch; the reporter moves the epoch on, and once the lane has acknowledged that, or
+// is idle awaiting frames, or has finished, the histogram of the epoch before is the reporter's to
+// collect and reset; the epoch and the acknowledgement go by sequentially consistent atomics, so
+// neither side may miss the other's move
+struct __attribute__ ((aligned(64))) soak_rtt {
+	enum {
+		idle_ack = ~0U
+	};
+
+	histogram* h[2];
+	uint32_t epoch; // written by the reporter
+	uint32_t ack;   // written by the lane: epoch it records to, or idle_ack
+	uint32_t done;  // written by the lane: finished recording
+
+	// lane: histogram to record the current batch to
+	histogram& current() {
+		for (;;) {
+			const uint32_t e = __atomic_load_n(&epoch, __ATOMIC_SEQ_CST);
+			__atomic_store_n(&ack, e, __ATOMIC_SEQ_CST);
+
+			if (e == __atomic_load_n(&epoch, __ATOMIC_SEQ_CST))
+				return *h[e & 1];
+		}
+	}
+
+	// lane: done recording for now, e.g. ahead of awaiting frames
+	void idle() {
+		__atomic_store_n(&ack, uint32_t(idle_ack), __ATOMIC_RELEASE);
+	}
+
+	// reporter: add the round-trip times recorded since the last collect to the specified histogram
+	void collect(histogram& to) {
+		const uint32_t e = __atomic_load_n(&epoch, __ATOMIC_RELAXED);
+		__atomic_store_n(&epoch, e + 1, __ATOMIC_SEQ_CST);
+
+		for (;;) {
+			const uint32_t a = __atomic_load_n(&ack, __ATOMIC_SEQ_CST);
+
+			if (e + 1 == a || idle_ack == a || __atomic_load_n(&done, __ATOMIC_ACQUIRE))
+				break;
+
+			// the lane is amid a batch
+			sched_yield();
+		}
+
+		to.add(*h[e & 1]);
+		h[e & 1]->reset();
+	}
+};
+
+#endif // soak_H__
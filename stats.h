@@ -0,0 +1,99 @@
+#ifndef stats_H__
+#define stats_H__
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+
+// summary of the headline figures of repeated runs: a handful of samples, so the median rather than
+// the mean, along with a distribution-free confidence interval of the median - the order statistics
+// x(k) and x(n + 1 - k) bracket the median with a probability of 1 - 2 P(B < k), B binomial of n and
+// 1/2, whatever the distribution of the figures; the mean and standard deviation go along, telling
+// the spread of the runs
+
+// confidence level aimed at
+static const double stats_confidence = 0.95;
+
+struct sample_summary {
+	uint32_t n;        // samples
+	double median;
+	double lo;         // confidence interval of the median
+	double hi;
+	double confidence; // coverage of the interval, at least stats_confidence unless too few samples
+	double min;
+	double max;
+	double mean;
+	double stddev;     // sample standard deviation, 0 for a single sample
+};
+
+static int stats_compare(
+	const void* const a,
+	const void* const b) {
+
+	const double x = *reinterpret_cast< const double* >(a);
+	const double y = *reinterpret_cast< const double* >(b);
+
+	return x < y ? -1 : y < x ? 1 : 0;
+}
+
+// summarize the samples, sorting them in place; with fewer than 6 samples no interval reaches 95%
+// coverage, and the interval is that of the extremes
+static void summarize(
+	double* const v,
+	const uint32_t n,
+	sample_summary& s) {
+
+	s.n = n;
+	s.median = 0.0;
+	s.lo = 0.0;
+	s.hi = 0.0;
+	s.confidence = 0.0;
+	s.min = 0.0;
+	s.max = 0.0;
+	s.mean = 0.0;
+	s.stddev = 0.0;
+
+	if (0 == n)
+		return;
+
+	qsort(v, n, sizeof(*v), stats_compare);
+
+	s.median = n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) * 0.5;
+	s.min = v[0];
+	s.max = v[n - 1];
+
+	for (uint32_t i = 0; i < n; ++i)
+		s.mean += v[i];
+
+	s.mean /= double(n);
+
+	for (uint32_t i = 0; 1 < n && i < n; ++i)
+		s.stddev += (v[i] - s.mean) * (v[i] - s.mean);
+
+	s.stddev = 1 < n ? sqrt(s.stddev / double(n - 1)) : 0.0;
+
+	// the widest k keeping the coverage aimed at, 1 at least; cdf is P(B < k), term P(B = k - 1)
+	double term = 1.0;
+
+	for (uint32_t i = 0; i < n; ++i)
+		term *= 0.5;
+
+	double cdf = term;
+	uint32_t k = 1;
+
+	while (k < (n + 1) / 2) {
+		const double next = term * double(n - k + 1) / double(k);
+
+		if (1.0 - 2.0 * (cdf + next) < stats_confidence)
+			break;
+
+		term = next;
+		cdf += term;
+		++k;
+	}
+
+	s.lo = v[k - 1];
+	s.hi = v[n - k];
+	s.confidence = 1.0 - 2.0 * cdf;
+}
+
+#endif // stats_H__
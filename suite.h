@@ -0,0 +1,239 @@
+#ifndef suite_H__
+#define suite_H__
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/utsname.h>
+#include "stats.h"
+
+// suite mode: the transmitter runs a session per cell of a matrix of engines, frame sizes, batches
+// and thread counts, each cell a warm-up run and a number of runs summarized by the median of their
+// headline figure; the cells go into a baseline file, and the cells of a later suite are held
+// against those of a baseline file, a cell whose interval misses the baseline median standing out
+// as a regression or an improvement.
+//
+// The baseline file is text, a line per cell - engine, frame size, batch, threads, mode, metric,
+// median, confidence interval - and # to the end of the line a comment; the header comment tells
+// the kernel the baseline was taken on
+
+// cells: values per axis, and cells of all axes
+static const uint32_t suite_axis_max = 8;
+static const uint32_t suite_cells_max = suite_axis_max * suite_axis_max * suite_axis_max * suite_axis_max;
+
+// the axes of the matrix, each a list of values; engines by engine type
+enum suite_axis_type {
+	suite_engines,
+	suite_sizes,
+	suite_batches,
+	suite_threads,
+
+	suite_axis_count
+};
+
+static const char* const suite_axis_name[suite_axis_count] = {
+	"engines",
+	"sizes",
+	"batches",
+	"threads"
+};
+
+struct suite_axis {
+	uint32_t v[suite_axis_max];
+	uint32_t count;
+
+	bool add(const uint32_t x) {
+		if (suite_axis_max == count)
+			return false;
+
+		v[count++] = x;
+		return true;
+	}
+};
+
+struct suite_matrix {
+	suite_axis axis[suite_axis_count];
+};
+
+struct suite_cell {
+	char engine[16];
+	uint32_t frame_size;
+	uint32_t batch;
+	uint32_t threads;
+	char mode[16];
+	char metric[32];      // name of the headline figure
+	bool higher_better;   // the metric is a rate rather than a time
+	sample_summary figure;
+};
+
+// held against the baseline: the cell regressed, is on a par with the baseline, or improved
+enum suite_verdict {
+	suite_regressed = -1,
+	suite_unchanged,
+	suite_improved
+};
+
+static const char* suite_verdict_name(const int verdict) {
+	return suite_regressed == verdict ? "regression" : suite_improved == verdict ? "improvement" : "unchanged";
+}
+
+// tell whether two cells are of the same setup
+static bool suite_same(
+	const suite_cell& a,
+	const suite_cell& b) {
+
+	return !strcmp(a.engine, b.engine) &&
+		a.frame_size == b.frame_size &&
+		a.batch == b.batch &&
+		a.threads == b.threads &&
+		!strcmp(a.mode, b.mode) &&
+		!strcmp(a.metric, b.metric);
+}
+
+// a cell against the baseline: a baseline median outside the interval of the cell is a change
+static int suite_judge(
+	const suite_cell& cell,
+	const suite_cell& base) {
+
+	const double b = base.figure.median;
+
+	if (b < cell.figure.lo)
+		return cell.higher_better ? suite_improved : suite_regressed;
+
+	if (b > cell.figure.hi)
+		return cell.higher_better ? suite_regressed : suite_improved;
+
+	return suite_unchanged;
+}
+
+class suite_baseline {
+	suite_cell* cell; // room for suite_cells_max cells, the caller's
+	uint32_t count;
+
+public:
+	char kernel[128]; // kernel release the baseline was taken on, as noted in the file
+
+	explicit suite_baseline(suite_cell* const room)
+	: cell(room)
+	, count(0) {
+		kernel[0] = '\0';
+	}
+
+	bool load(const char* const path) {
+		FILE* const f = fopen(path, "r");
+
+		if (0 == f) {
+			fprintf(stderr, "error: cannot open baseline file %s (errno: %s)\n", path, strerror(errno));
+			return false;
+		}
+
+		char line[512];
+		uint32_t n = 0;
+
+		while (0 != fgets(line, sizeof(line), f)) {
+			++n;
+
+			if (1 == sscanf(line, "# kernel %127s", kernel))
+				continue;
+
+			line[strcspn(line, "#\n")] = '\0';
+
+			if ('\0' == line[strspn(line, " \t\r")])
+				continue;
+
+			if (count == suite_cells_max) {
+				fprintf(stderr, "error: baseline file %s exceeds %u cells, line %u\n", path, suite_cells_max, n);
+				fclose(f);
+				return false;
+			}
+
+			suite_cell& c = cell[count];
+			char tail[2];
+
+			memset(&c, 0, sizeof(c));
+
+			if (9 != sscanf(line, "%15s %u %u %u %15s %31s %lf %lf %lf %1s",
+					c.engine,
+					&c.frame_size,
+					&c.batch,
+					&c.threads,
+					c.mode,
+					c.metric,
+					&c.figure.median,
+					&c.figure.lo,
+					&c.figure.hi,
+					tail)) {
+
+				fprintf(stderr, "error: malformed baseline file %s, line %u\n", path, n);
+				fclose(f);
+				return false;
+			}
+
+			++count;
+		}
+
+		fclose(f);
+		return true;
+	}
+
+	// the baseline cell of the setup of the given cell, 0 if none
+	const suite_cell* find(const suite_cell& c) const {
+		for (uint32_t i = 0; i < count; ++i) {
+			if (suite_same(cell[i], c))
+				return cell + i;
+		}
+
+		return 0;
+	}
+};
+
+// write the cells out as a baseline file
+static bool suite_save(
+	const char* const path,
+	const suite_cell* const cell,
+	const uint32_t count) {
+
+	FILE* const f = fopen(path, "w");
+
+	if (0 == f) {
+		fprintf(stderr, "error: cannot open baseline file %s (errno: %s)\n", path, strerror(errno));
+		return false;
+	}
+
+	utsname u;
+	char host[256] = "";
+
+	if (0 > uname(&u))
+		memset(&u, 0, sizeof(u));
+
+	snprintf(host, sizeof(host), "%s", u.nodename);
+
+	fprintf(f, "# bandw suite baseline, host %s, time %llu\n", host, (unsigned long long) time(0));
+	fprintf(f, "# kernel %s\n", '\0' != u.release[0] ? u.release : "unknown");
+	fprintf(f, "# engine frame_size batch threads mode metric median ci_lo ci_hi\n");
+
+	for (uint32_t i = 0; i < count; ++i) {
+		const suite_cell& c = cell[i];
+
+		fprintf(f, "%s %u %u %u %s %s %.6f %.6f %.6f\n",
+				c.engine,
+				c.frame_size,
+				c.batch,
+				c.threads,
+				c.mode,
+				c.metric,
+				c.figure.median,
+				c.figure.lo,
+				c.figure.hi);
+	}
+
+	if (0 != fclose(f)) {
+		fprintf(stderr, "error: cannot write baseline file %s (errno: %s)\n", path, strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
+#endif // suite_H__
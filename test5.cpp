@@ -1,14 +1,25 @@
 //
-// bandw - a rudimentary bandwidth-metering tool for eth networks (half-duplex)
+// bandw - a rudimentary bandwidth-metering tool for eth networks (half- or full-duplex)
 //
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <limits.h>
 #include <memory.h>
 #include <unistd.h>
 #include <assert.h>
 #include "timer.h"
+#include "histogram.h"
+#include "timestamp.h"
+#include "wire.h"
+#include "soak.h"
+#include "report.h"
+#include "perf.h"
+#include "payload.h"
+#include "stats.h"
+#include "suite.h"
+#include "placement.h"
 
 #include <arpa/inet.h>
 #include <sys/types.h>
@@ -16,23 +27,151 @@
 #include <errno.h>
 
 // raw ethernet frames
-#include <netpacket/packet.h>
+#include <linux/if_packet.h> // superset of netpacket/packet.h, incl. tpacket rings
 #include <net/ethernet.h>
 #include <net/if.h>
 #include <net/if_arp.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <linux/filter.h>
+#include <linux/ethtool.h>
+#include <linux/sockios.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "engine_socket.h"
+#include "engine_ring.h"
+#include "engine_mmsg.h"
+#include "engine_xdp.h"
+#include "engine_uring.h"
+#include "engine_udp.h"
+#include "engine_tcp.h"
 
 static const char argInterface[]   = "-interface";
 static const char argTarget[]      = "-target";
 static const char argPacketCount[] = "-packetcount";
 static const char argTransmitter[] = "-transmitter";
+static const char argEngine[]      = "-engine";
+static const char argBatch[]       = "-batch";
+static const char argQueue[]       = "-queue";
+static const char argThreads[]     = "-threads";
+static const char argDuplex[]      = "-duplex";
+static const char argLatency[]     = "-latency";
+static const char argHistogram[]   = "-histogram";
+static const char argTimestamp[]   = "-timestamp";
+static const char argSize[]        = "-size";
+static const char argSweep[]       = "-sweep";
+static const char argRate[]        = "-rate";
+static const char argTimeout[]     = "-timeout";
+static const char argDuration[]    = "-duration";
+static const char argInterval[]    = "-interval";
+static const char argFormat[]      = "-format";
+static const char argPerf[]        = "-perf";
+static const char argPoll[]        = "-poll";
+static const char argSndbuf[]      = "-sndbuf";
+static const char argRcvbuf[]      = "-rcvbuf";
+static const char argPriority[]    = "-priority";
+static const char argQdiscBypass[] = "-qdiscbypass";
+static const char argTxLoss[]      = "-txloss";
+static const char argHugepages[]   = "-hugepages";
+static const char argPayload[]     = "-payload";
+static const char argVerify[]      = "-verify";
+static const char argReflect[]     = "-reflect";
+static const char argPeers[]       = "-peers";
+static const char argVlan[]        = "-vlan";
+static const char argRuns[]        = "-runs";
+static const char argSuite[]       = "-suite";
+static const char argBaseline[]    = "-baseline";
+static const char argSave[]        = "-save";
+static const char argWarmup[]      = "-warmup";
+static const char argCpu[]         = "-cpu";
+static const char argRtPriority[]  = "-rt-priority";
+static const char argIrq[]         = "-irq";
+static const char argSqpoll[]      = "-sqpoll";
+
+enum engine_type {
+	engine_type_socket, // one sendto/recvfrom per frame
+	engine_type_ring,   // mmap'd TPACKET_V3 rings
+	engine_type_mmsg,   // a batch of frames per sendmmsg/recvmmsg
+	engine_type_xdp,    // AF_XDP socket on one iface queue
+	engine_type_uring,  // io_uring requests kept in flight on the packet socket
+	engine_type_udp,    // a udp datagram per frame, through the ip stack
+	engine_type_tcp,    // a tcp stream of frames, through the ip stack
+
+	engine_type_count
+};
+
+static const char* const engine_name[engine_type_count] = {
+	"socket",
+	"ring",
+	"mmsg",
+	"xdp",
+	"uring",
+	"udp",
+	"tcp"
+};
+
+// the transport engines take the frames through the ip stack, so the ends have to go by the same
+// one; the raw engines get along with each other
+static bool engines_agree(
+	const uint32_t a,
+	const uint32_t b) {
+
+	const bool transport_a = engine_type_udp == a || engine_type_tcp == a;
+	const bool transport_b = engine_type_udp == b || engine_type_tcp == b;
 
-static const uint32_t magic = 0x32100123;
+	return transport_a || transport_b ? a == b : true;
+}
+
+// ethertype of the test frames, whose payload starts with the test header, see wire.h
+static const uint16_t frame_proto = wire_proto;
+
+// upper bound on worker threads, over all peers
+static const uint32_t threads_max = 64;
+
+// upper bound on peers: responders a transmitter fans out to, or transmitters a responder fans in from
+static const uint32_t peers_max = 16;
+
+// upper bound on the cores of a -cpu list, one per lane
+static const uint32_t cpu_list_max = 2 * threads_max;
+
+// 802.1Q: highest vlan id, 4095 being reserved; priority classes, by priority code point
+static const uint32_t vlan_id_max = 4094;
+static const uint32_t pcp_max = 8;
 
 // eth frame geometry, sans preamble and FCS/CRC
-static const size_t frame_min_size = ETH_ZLEN;      // minimal frame size (14 octets header + 46 octets payload)
-static const size_t frame_max_size = ETH_FRAME_LEN; // full frame size (14 octets header + 1500 octets payload)
-static const size_t packet_size = ETH_DATA_LEN;     // payload in the full frame
+static const size_t frame_min_size = ETH_ZLEN;          // minimal frame size (14 octets header + 46 octets payload)
+static const size_t frame_full_size = ETH_FRAME_LEN;    // full frame size (14 octets header + 1500 octets payload)
+static const size_t frame_max_size = ETH_HLEN + 9000;   // jumbo frame size (14 octets header + 9000 octets payload)
+
+// per-frame overhead on the wire: preamble and start delimiter, FCS, minimal inter-frame gap
+static const size_t frame_wire_overhead = 8 + ETH_FCS_LEN + 12;
+
+// pause of the transmitter ahead of each run, letting the responder set up for the frame size, ms
+static const uint32_t setup_pause_ms = 200;
+
+// the transmitter repeats its handshake offer every so many ms, up to so many times
+static const int handshake_interval_ms = 100;
+static const uint32_t handshake_attempts = 50;
+
+// ms without frames after which the receiving side counts the frames still due as lost, unless
+// specified otherwise; the transmitter waits for the first response for a couple of those
+static const uint32_t default_rx_timeout = 1000;
+static const int first_frame_timeouts = 2;
+
+// frames per kernel kick by the batching engines, unless specified otherwise
+static const size_t default_batch = 64;
+
+// soak mode: s between reports, unless specified otherwise
+static const double default_report_interval = 1.0;
+
+// upper bound on runs per frame size
+static const uint32_t runs_max = 100;
+
+// suite mode: runs per cell, unless specified otherwise, and warm-up runs ahead of those
+static const uint32_t default_suite_runs = 5;
+static const uint32_t suite_warmup_runs = 1;
 
 class non_copyable
 {
@@ -87,8 +226,7 @@ static bool init_ethhdr_and_saddr(
 
 	assert(IFNAMSIZ	> iface_namelen);
 
-	// pretend we're an established protocol type, lest we get dropped by some self-important filter
-	const uint16_t proto = ETH_P_IP;
+	const uint16_t proto = frame_proto;
 
 	// simultaneously fill-in socket address and eth frame header
 	memset(&saddr, 0, sizeof(saddr));
@@ -130,203 +268,4106 @@ static bool init_ethhdr_and_saddr(
 	return true;
 }
 
-int main(
-	int argc,
-	char** argv) {
+// make sure frames of the specified size fit the iface mtu
+static bool check_mtu(
+	const int fd,                 // file descriptor
+	const char* const iface_name, // iface name, cstr
+	const size_t iface_namelen,   // iface name length, shorter than IFNAMSIZ
+	const size_t frame_size) {    // frame size, header included
 
-	uint32_t iface_nameidx    = 0;
-	uint32_t iface_namelen    = 0;
-	uint8_t target[8]         = { 0 };
-	uint32_t packet_count     = 0;
-	uint32_t flags            = 0;
-	enum {
-		flag_transmitter = 1,
-		flag_target      = 2
-	};
+	ifreq ifr;
+	memcpy(ifr.ifr_name, iface_name, iface_namelen);
+	ifr.ifr_name[iface_namelen] = '\0';
 
-	// get command line arguments
-	bool cmd_err = false;
+	if (-1 == ioctl(fd, SIOCGIFMTU, &ifr)) {
+		fprintf(stderr, "error: cannot obtain iface mtu (errno %s)\n", strerror(errno));
+		return false;
+	}
 
-	for (uint32_t i = 1; i < argc && !cmd_err; ++i) {
-		cmd_err = true;
+	if (frame_size - ETH_HLEN > size_t(ifr.ifr_mtu)) {
+		fprintf(stderr, "error: frame size %zu exceeds iface mtu %d\n", frame_size, ifr.ifr_mtu);
+		return false;
+	}
 
-		if (!strcmp(argv[i], argInterface)) {
-			if (++i < argc && !iface_nameidx) {
-				iface_namelen = strlen(argv[i]);
+	return true;
+}
 
-				if (IFNAMSIZ > iface_namelen) {
-					iface_nameidx = i;
-					cmd_err = false;
-				}
-			}
-			continue;
-		}
+// the test frames carry no ip header for rss to hash, so without flow steering rules on the iface they
+// all arrive on one queue, leaving the xdp engines bound to the other queues with nothing to receive;
+// warn of an iface without any, the rules themselves being up to the NIC and its driver
+static void check_flow_steering(
+	const int fd,                 // file descriptor
+	const char* const iface_name, // iface name, cstr
+	const size_t iface_namelen,   // iface name length, shorter than IFNAMSIZ
+	const uint32_t threads) {     // workers, each on a queue of its own
 
-		if (!strcmp(argv[i], argTarget)) {
-			if (++i < argc && !(flags & flag_target)) {
-				if (6 == sscanf(argv[i], "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx",
-					&target[0],
-					&target[1],
-					&target[2],
-					&target[3],
-					&target[4],
-					&target[5]))
-				{
-					flags |= flag_target;
-					cmd_err = false;
-				}
+	ethtool_rxnfc nfc;
+	memset(&nfc, 0, sizeof(nfc));
+	nfc.cmd = ETHTOOL_GRXCLSRLCNT;
+
+	ifreq ifr;
+	memcpy(ifr.ifr_name, iface_name, iface_namelen);
+	ifr.ifr_name[iface_namelen] = '\0';
+	ifr.ifr_data = reinterpret_cast< char* >(&nfc);
+
+	if (-1 == ioctl(fd, SIOCETHTOOL, &ifr))
+		fprintf(stderr, "warning: xdp engine with %u threads: cannot obtain the flow steering rules of iface %s (errno: %s); "
+			"rss cannot spread the test frames over the queues of the workers\n", threads, iface_name, strerror(errno));
+	else if (0 == nfc.rule_cnt)
+		fprintf(stderr, "warning: xdp engine with %u threads: no flow steering rules on iface %s; "
+			"rss cannot spread the test frames over the queues of the workers\n", threads, iface_name);
+}
+
+// send frames [seq_begin, seq_end) of the test sequence; the rest of the test header comes with
+// the template frame
+template < class ENGINE_T >
+static bool send_sequence(
+	ENGINE_T& engine,
+	const payload_spec& body,
+	const uint64_t seq_begin,
+	const uint64_t seq_end,
+	const uint32_t session,
+	const double interval) { // ns from one frame to the next, 0 to send as fast as possible
+
+	// paced frames go one at a time, each at its due time past the start
+	const size_t burst = 0.0 < interval ? 1 : batch_max;
+	const uint64_t t0 = timer_ns();
+
+	for (uint64_t i = seq_begin; i < seq_end;) {
+		uint8_t* frame[batch_max];
+		const uint64_t left = seq_end - i;
+		const size_t count = engine.tx_acquire(frame, left < burst ? left : burst);
+
+		if (0 == count)
+			return false;
+
+		if (0.0 < interval) {
+			const uint64_t due = t0 + uint64_t(double(i - seq_begin) * interval);
+
+			while (timer_ns() < due) {
 			}
-			continue;
 		}
 
-		if (!strcmp(argv[i], argPacketCount)) {
-			if (++i < argc && !packet_count) {
-				uint32_t count = 0;
+		for (size_t j = 0; j < count; ++j, ++i) {
+			uint8_t* const payload = frame[j] + ETH_HLEN;
 
-				if (1 == sscanf(argv[i], "%u", &count) && count) {
-					packet_count = count;
-					cmd_err = false;
-				}
-			}
-			continue;
+			wire_set_seq(payload, i);
+			wire_set_session(payload, session);
+			body.stamp(payload, i);
 		}
 
-		if (!strcmp(argv[i], argTransmitter)) {
-			flags |= flag_transmitter;
-			cmd_err = false;
-			continue;
+		if (!engine.tx_commit(count))
+			return false;
+	}
+
+	return engine.tx_flush();
+}
+
+// record the wire-side gap between the i-th frame from the last rx_acquire and the frame before it
+template < class ENGINE_T >
+static void record_gap(
+	ENGINE_T& engine,
+	const size_t i,
+	uint64_t& last, // timestamp of the frame before, 0 if none; updated
+	histogram& gap) {
+
+	uint64_t t;
+
+	if (!engine.rx_timestamp(i, t))
+		return;
+
+	if (0 != last && t >= last)
+		gap.record(t - last);
+
+	last = t;
+}
+
+// tracker of the frames received of a share [seq_begin, seq_end) of the test sequence: a bitmap
+// over the sequence space tells the frames received already, so frames may arrive in any order,
+// more than once or not at all; frames not of this share are counted and skipped
+class seq_tracker : non_copyable {
+	uint64_t* seen;
+	uint64_t begin;
+	uint64_t end;
+	uint64_t top; // one past the highest frame received
+
+public:
+	uint64_t received;  // distinct frames of the share
+	uint64_t duplicate; // frames received more than once
+	uint64_t reordered; // frames received after a higher one
+	uint64_t foreign;   // frames not of the share, or not of the test at all
+	uint64_t corrupt;   // frames of the test whose body failed verification, skipped
+
+	seq_tracker()
+	: seen(0)
+	, begin(0)
+	, end(0)
+	, top(0)
+	, received(0)
+	, duplicate(0)
+	, reordered(0)
+	, foreign(0)
+	, corrupt(0) {
+	}
+
+	~seq_tracker() {
+		free(seen);
+	}
+
+	bool init(
+		const uint64_t seq_begin,
+		const uint64_t seq_end) {
+
+		seen = reinterpret_cast< uint64_t* >(calloc((seq_end - seq_begin) / 64 + 1, sizeof(uint64_t)));
+
+		if (0 == seen) {
+			fprintf(stderr, "error: cannot allocate sequence bitmap\n");
+			return false;
 		}
+
+		begin = seq_begin;
+		end = seq_end;
+		top = seq_begin;
+		return true;
 	}
 
-	if (cmd_err || !iface_nameidx || !(flags & flag_target) || !packet_count) {
-		printf("usage: %s %s iface %s target_mac %s N [%s]\n",
-				argv[0],
-				argInterface,
-				argTarget,
-				argPacketCount,
-				argTransmitter);
-		return -1;
+	// account for a frame of the test; return whether it is a frame of the share not received before
+	bool accept(const uint64_t seq) {
+		if (seq < begin || seq >= end) {
+			++foreign;
+			return false;
+		}
+
+		uint64_t& word = seen[(seq - begin) / 64];
+		const uint64_t bit = uint64_t(1) << (seq - begin) % 64;
+
+		if (word & bit) {
+			++duplicate;
+			return false;
+		}
+
+		word |= bit;
+		++received;
+
+		if (seq < top)
+			++reordered;
+		else
+			top = seq + 1;
+
+		return true;
 	}
 
-	// room for two ethernet frames, please
-	const scoped< uint8_t*, generic_free > frame(
-		reinterpret_cast< uint8_t* >(malloc(frame_max_size * 2)));
+	// account for a frame not of the test
+	void reject() {
+		++foreign;
+	}
 
-	if (0 == frame) {
-		fprintf(stderr, "error: cannot allocate buffer\n");
-		return -1;
+	// account for a frame of the test with a corrupt body
+	void damaged() {
+		++corrupt;
 	}
 
-	// frame0 - outgoing, frame1 - incoming
-	uint8_t* const frame0 = frame;
-	uint8_t* const frame1 = frame + frame_max_size;
-	uint8_t* const payload0 = frame0 + ETH_HLEN;
-	uint8_t* const payload1 = frame1 + ETH_HLEN;
+	bool done() const {
+		return received == end - begin;
+	}
 
-	// get an ethernet socket
-	const scoped< int, close_file_descriptor > fd(
-		socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL)));
+	uint64_t lost() const {
+		return end - begin - received;
+	}
 
-	if (0 > fd) {
-		fprintf(stderr, "error: cannot create socket\n");
-		return -1;
+	void add(const seq_tracker& other) {
+		received += other.received;
+		duplicate += other.duplicate;
+		reordered += other.reordered;
+		foreign += other.foreign;
+		corrupt += other.corrupt;
 	}
+};
 
-	sockaddr_ll saddr;
+// tell whether a frame is one of the test session, going the expected way, and its sequence number
+static bool frame_of_test(
+	const uint8_t* const frame,
+	const size_t len,
+	const size_t frame_size, // size of all frames of the test
+	const bool response,     // frame expected from the responder rather than the transmitter
+	uint32_t& session,       // session id; 0 to adopt that of the first frame of the test
+	uint64_t& seq) {         // output: sequence number
 
-	if (!init_ethhdr_and_saddr(fd, argv[iface_nameidx], iface_namelen, target, *reinterpret_cast< ethhdr* >(frame0), saddr)) {
-		return -1;
+	if (frame_size != len)
+		return false;
+
+	const uint8_t* const payload = frame + ETH_HLEN;
+
+	if (!wire_valid(payload, frame_size) ||
+		(wire_flags_of(payload) & (wire_flag_response | wire_flag_control)) != (response ? wire_flag_response : 0))
+		return false;
+
+	const uint32_t id = wire_session_of(payload);
+
+	if (0 == session)
+		session = id;
+	else if (id != session)
+		return false;
+
+	seq = wire_seq_of(payload);
+	return true;
+}
+
+// receive the frames of a share of the test sequence, in any order, until all have arrived or none
+// has for the rx timeout; before the first frame, sit through the specified number of timeouts, as
+// the peer may not be sending yet; flag the first frame
+template < class ENGINE_T >
+static bool recv_sequence(
+	ENGINE_T& engine,
+	const payload_spec& body,
+	const size_t frame_size, // size of all frames
+	const bool response,    // frames expected from the responder rather than the transmitter
+	uint32_t& session,      // session id; 0 to adopt that of the first frame
+	seq_tracker& tracker,
+	const int first_wait,   // rx timeouts to wait for the first frame, -1 to wait indefinitely
+	uint64_t& t0,           // output: time of the first frame, unless set already
+	uint32_t& going,        // output: set at the first frame
+	histogram* const gap) { // output: wire-side gaps between frames, 0 if not timestamping
+
+	uint64_t last = 0;
+	int waited = 0;
+
+	while (!tracker.done()) {
+		const uint8_t* frame[batch_max];
+		size_t len[batch_max];
+		const size_t count = engine.rx_acquire(frame, len, batch_max);
+
+		if (0 == count) {
+			if (EAGAIN != errno && EWOULDBLOCK != errno)
+				return false;
+
+			// the stream has dried up - whatever has not arrived by now is lost
+			if (going || (0 <= first_wait && ++waited >= first_wait))
+				break;
+
+			continue;
+		}
+
+		for (size_t j = 0; j < count; ++j) {
+			uint64_t seq;
+
+			if (!frame_of_test(frame[j], len[j], frame_size, response, session, seq)) {
+				tracker.reject();
+				continue;
+			}
+
+			if (!body.intact(frame[j] + ETH_HLEN)) {
+				tracker.damaged();
+				continue;
+			}
+
+			if (!tracker.accept(seq))
+				continue;
+
+			if (!going) {
+				if (0 == t0)
+					t0 = timer_ns();
+
+				__atomic_store_n(&going, 1, __ATOMIC_RELEASE);
+			}
+
+			if (0 != gap)
+				record_gap(engine, j, last, *gap);
+		}
+
+		engine.rx_release();
 	}
 
-	// bind socket to specified iface (for the receiving part)
-	if (0 > bind(fd, reinterpret_cast< sockaddr* >(&saddr), sizeof(saddr))) {
-		fprintf(stderr, "error: cannot bind to iface\n");
-		return -1;
+	return true;
+}
+
+// send frames [seq_begin, seq_end) of the test sequence one at a time, stamped with the time of
+// sending, and await the echo of each before sending the next, up to the rx timeout; record the
+// round-trip times
+template < class ENGINE_T >
+static bool ping_sequence(
+	ENGINE_T& engine,
+	const payload_spec& body,
+	const size_t frame_size, // size of all frames
+	const uint64_t seq_begin,
+	const uint64_t seq_end,
+	uint32_t session,
+	seq_tracker& tracker,
+	histogram& rtt,
+	histogram* const wire) { // output: wire-side round-trip times, 0 if not timestamping
+
+	for (uint64_t i = seq_begin; i < seq_end; ++i) {
+		uint8_t* frame_tx;
+
+		if (0 == engine.tx_acquire(&frame_tx, 1))
+			return false;
+
+		uint8_t* const payload_tx = frame_tx + ETH_HLEN;
+
+		wire_set_seq(payload_tx, i);
+		wire_set_session(payload_tx, session);
+		body.stamp(payload_tx, i);
+		wire_set_timestamp(payload_tx, timer_ns());
+
+		if (!engine.tx_commit(1) || !engine.tx_flush())
+			return false;
+
+		uint64_t wire_tx;
+		const bool wire_tx_valid = 0 != wire && engine.tx_timestamp(wire_tx);
+
+		// await the echo of this very frame; late echoes of earlier frames are accounted for only
+		for (;;) {
+			const uint8_t* frame_rx = 0;
+			size_t len = 0;
+
+			if (0 == engine.rx_acquire(&frame_rx, &len, 1)) {
+				if (EAGAIN != errno && EWOULDBLOCK != errno)
+					return false;
+
+				break;
+			}
+
+			const uint64_t t = timer_ns();
+			uint64_t seq;
+
+			if (!frame_of_test(frame_rx, len, frame_size, true, session, seq)) {
+				tracker.reject();
+				engine.rx_release();
+				continue;
+			}
+
+			if (!body.intact(frame_rx + ETH_HLEN)) {
+				tracker.damaged();
+				engine.rx_release();
+				continue;
+			}
+
+			if (!tracker.accept(seq) || seq != i) {
+				engine.rx_release();
+				continue;
+			}
+
+			rtt.record(t - wire_timestamp_of(frame_rx + ETH_HLEN));
+
+			uint64_t wire_rx;
+
+			if (wire_tx_valid && engine.rx_timestamp(0, wire_rx) && wire_rx >= wire_tx)
+				wire->record(wire_rx - wire_tx);
+
+			engine.rx_release();
+			break;
+		}
 	}
 
-	if (flags & flag_transmitter) { // are we a transmitter?
+	return true;
+}
+
+// receive frames of a share of the test sequence, or of the endless sequence of soak mode, and echo
+// each straight back along with its timestamp, until all have arrived or none has for the rx timeout
+template < class ENGINE_T, class TRACKER_T >
+static bool echo_sequence(
+	ENGINE_T& engine,
+	const payload_spec& body,
+	const size_t frame_size, // size of all frames
+	uint32_t& session,       // session id; 0 to adopt that of the first frame
+	TRACKER_T& tracker) {    // seq_tracker or seq_window
 
-		printf("transmitter at interface %s\n", argv[iface_nameidx]);
+	bool going = false;
 
-		const uint64_t t0 = timer_ns();
+	while (!tracker.done()) {
+		const uint8_t* frame_rx[batch_max];
+		size_t len[batch_max];
+		const size_t count = engine.rx_acquire(frame_rx, len, batch_max);
+
+		if (0 == count) {
+			if (EAGAIN != errno && EWOULDBLOCK != errno)
+				return false;
+
+			if (going)
+				break;
+
+			continue;
+		}
 
-		for (uint32_t i = 0; i < packet_count; ++i) {
-			// this communication is intended for same-endian peers -- no need to go through network endianness
-			reinterpret_cast< uint32_t* >(payload0)[0] = magic;
-			reinterpret_cast< uint32_t* >(payload0)[1] = i;
+		for (size_t j = 0; j < count; ++j) {
+			uint64_t seq;
 
-			const ssize_t sent = sendto(fd, frame0, frame_max_size, 0, reinterpret_cast< sockaddr* >(&saddr), sizeof(saddr));
+			if (!frame_of_test(frame_rx[j], len[j], frame_size, false, session, seq)) {
+				tracker.reject();
+				continue;
+			}
 
-			if (frame_max_size != sent) {
-				fprintf(stderr, "error: sendto() failed to send requested byte count (errno: %s)\n", strerror(errno));
-				return -1;
+			if (!body.intact(frame_rx[j] + ETH_HLEN)) {
+				tracker.damaged();
+				continue;
 			}
+
+			if (!tracker.accept(seq))
+				continue;
+
+			going = true;
+
+			uint8_t* frame_tx;
+
+			if (0 == engine.tx_acquire(&frame_tx, 1))
+				return false;
+
+			const uint8_t* const payload_rx = frame_rx[j] + ETH_HLEN;
+			uint8_t* const payload_tx = frame_tx + ETH_HLEN;
+
+			wire_set_seq(payload_tx, seq);
+			wire_set_session(payload_tx, session);
+			body.stamp(payload_tx, seq);
+			wire_set_timestamp(payload_tx, wire_timestamp_of(payload_rx));
+
+			if (!engine.tx_commit(1))
+				return false;
+		}
+
+		engine.rx_release();
+
+		if (!engine.tx_flush())
+			return false;
+	}
+
+	return true;
+}
+
+// reflector: receive frames of the test and send each back from where it was received, addresses
+// swapped and flagged as a response, but otherwise as it came in - sequence number, timestamp and body
+// alike; a batch at a time, with no tx frame, copy or regeneration involved, and with no knowledge of
+// the sequence, until none has arrived for the rx timeout once going, or the specified count is in
+template < class ENGINE_T >
+static bool reflect_sequence(
+	ENGINE_T& engine,
+	const payload_spec& body,
+	const size_t frame_size, // size of all frames
+	uint32_t& session,       // session id; 0 to adopt that of the first frame
+	seq_window& window,
+	const uint64_t count) {  // frames to reflect, 0 for no end but the rx timeout
+
+	bool going = false;
+
+	while (0 == count || window.received < count) {
+		const uint8_t* frame[batch_max];
+		size_t len[batch_max];
+		const size_t got = engine.rx_acquire(frame, len, batch_max);
+
+		if (0 == got) {
+			if (EAGAIN != errno && EWOULDBLOCK != errno)
+				return false;
+
+			if (going)
+				break;
+
+			continue;
 		}
 
-		for (uint32_t i = 0; i < packet_count; ++i) {
-			const ssize_t recv = recvfrom(fd, frame1, frame_max_size, 0, 0, 0);
+		size_t index[batch_max];
+		size_t n = 0;
+
+		for (size_t j = 0; j < got; ++j) {
+			uint64_t seq;
 
-			if (frame_max_size != recv) {
-				fprintf(stderr, "error: recvfrom() got unexpected byte count (errno: %s)\n", strerror(errno));
-				return -1;
+			if (!frame_of_test(frame[j], len[j], frame_size, false, session, seq)) {
+				window.reject();
+				continue;
 			}
 
-			if (reinterpret_cast< uint32_t* >(payload1)[0] != magic ||
-				reinterpret_cast< uint32_t* >(payload1)[1] != i) {
+			if (!body.intact(frame[j] + ETH_HLEN)) {
+				window.damaged();
+				continue;
+			}
+
+			if (!window.accept(seq))
+				continue;
+
+			// the engine lets us rewrite the frames it is to reflect
+			uint8_t* const f = const_cast< uint8_t* >(frame[j]);
+			uint8_t mac[ETH_ALEN];
+
+			memcpy(mac, f, ETH_ALEN);
+			memcpy(f, f + ETH_ALEN, ETH_ALEN);
+			memcpy(f + ETH_ALEN, mac, ETH_ALEN);
+			wire_set_flags(f + ETH_HLEN, wire_flags_of(f + ETH_HLEN) | wire_flag_response);
 
-				fprintf(stderr, "error: bad response package %u\n", i);
-				return -1;
-			} 
+			index[n++] = j;
 		}
 
-		const uint64_t dt = timer_ns() - t0;
+		going = going || 0 != n;
 
-		if (0 != dt) {
-			const double transcieved = double(packet_size) * double(packet_count) * 2.0;
-			const double s = double(dt) * 1e-9;
-			const double bandwidth = transcieved / s;
+		if (!engine.rx_reflect(index, n))
+			return false;
+	}
 
-			printf("elapsed time %f s\ntransceived %.0f bytes\nbandwidth %f bytes/s\n",
-					s,
-					transcieved,
-					bandwidth);
+	return engine.tx_flush();
+}
+
+// soak mode: stream frames of an endless sequence, stamped with the time of sending, until the
+// specified time; publish the count of frames sent once per batch
+template < class ENGINE_T >
+static bool soak_send(
+	ENGINE_T& engine,
+	const payload_spec& body,
+	const uint32_t session,
+	const double interval, // ns from one frame to the next, 0 to send as fast as possible
+	const uint64_t t_end,  // time to stop at
+	uint64_t& sent) {      // output: frames sent so far
+
+	const size_t burst = 0.0 < interval ? 1 : batch_max;
+	const uint64_t t0 = timer_ns();
+
+	for (uint64_t i = 0, t = t0; t < t_end;) {
+		uint8_t* frame[batch_max];
+		const size_t count = engine.tx_acquire(frame, burst);
+
+		if (0 == count)
+			return false;
+
+		if (0.0 < interval) {
+			const uint64_t due = t0 + uint64_t(double(i) * interval);
+
+			while ((t = timer_ns()) < due) {
+			}
 		}
 		else
-			printf("session failed\n");
+			t = timer_ns();
+
+		for (size_t j = 0; j < count; ++j, ++i) {
+			uint8_t* const payload = frame[j] + ETH_HLEN;
+
+			wire_set_seq(payload, i);
+			wire_set_session(payload, session);
+			body.stamp(payload, i);
+			wire_set_timestamp(payload, t);
+		}
+
+		if (!engine.tx_commit(count))
+			return false;
+
+		__atomic_store_n(&sent, i, __ATOMIC_RELAXED);
 	}
-	else { // we are a responder
 
-		printf("responder at interface %s\n", argv[iface_nameidx]);
+	return engine.tx_flush();
+}
 
-		for (uint32_t i = 0; i < packet_count; ++i) {
-			const ssize_t recv = recvfrom(fd, frame1, frame_max_size, 0, 0, 0);
+// soak mode: receive the echoes of the stream, recording the round-trip times, until the sending
+// lane is done and none has arrived for the rx timeout; publish the figures once per batch
+template < class ENGINE_T >
+static bool soak_recv(
+	ENGINE_T& engine,
+	const payload_spec& body,
+	const size_t frame_size, // size of all frames
+	uint32_t& session,       // session id
+	seq_window& window,
+	soak_counters& counters, // output: figures so far
+	soak_rtt& rtt,           // output: round-trip times
+	const uint32_t& tx_done) { // set by the sending lane once done
 
-			if (frame_max_size != recv) {
-				fprintf(stderr, "error: recvfrom() got unexpected byte count (errno: %s)\n", strerror(errno));
-				return -1;
-			}
+	for (;;) {
+		const uint8_t* frame[batch_max];
+		size_t len[batch_max];
 
-			// this communication is intended for same-endian peers -- no need to go through network endianness
-			if (reinterpret_cast< uint32_t* >(payload1)[0] != magic ||
-				reinterpret_cast< uint32_t* >(payload1)[1] != i) {
+		rtt.idle();
+		const size_t count = engine.rx_acquire(frame, len, batch_max);
 
-				fprintf(stderr, "error: bad request package %u\n", i);
-				return -1;
-			} 
+		if (0 == count) {
+			if (EAGAIN != errno && EWOULDBLOCK != errno)
+				return false;
+
+			if (__atomic_load_n(&tx_done, __ATOMIC_ACQUIRE))
+				break;
+
+			continue;
 		}
 
-		for (uint32_t i = 0; i < packet_count; ++i) {
-			reinterpret_cast< uint32_t* >(payload0)[0] = magic;
-			reinterpret_cast< uint32_t* >(payload0)[1] = i;
+		const uint64_t t = timer_ns();
+		histogram& h = rtt.current();
+
+		for (size_t j = 0; j < count; ++j) {
+			uint64_t seq;
 
-			const ssize_t sent = sendto(fd, frame0, frame_max_size, 0, reinterpret_cast< sockaddr* >(&saddr), sizeof(saddr));
+			if (!frame_of_test(frame[j], len[j], frame_size, true, session, seq)) {
+				window.reject();
+				continue;
+			}
 
-			if (frame_max_size != sent) {
-				fprintf(stderr, "error: sendto() failed to send requested byte count (errno: %s)\n", strerror(errno));
-				return -1;
+			if (!body.intact(frame[j] + ETH_HLEN)) {
+				window.damaged();
+				continue;
 			}
+
+			if (window.accept(seq))
+				h.record(t - wire_timestamp_of(frame[j] + ETH_HLEN));
 		}
+
+		engine.rx_release();
+		counters.publish(window);
 	}
 
+	return true;
+}
+
+// have the kernel drop all incoming frames but those of the test from the peer, before they get
+// queued on the socket; drop whatever got queued before the filter was in place
+static bool attach_filter(
+	const int fd,
+	const uint8_t* const peer) { // peer mac address, 0 to accept test frames from anyone
+
+	const uint32_t mac_hi = peer ? uint32_t(peer[0]) << 24 | uint32_t(peer[1]) << 16 | uint32_t(peer[2]) << 8 | peer[3] : 0;
+	const uint32_t mac_lo = peer ? uint32_t(peer[4]) << 8 | peer[5] : 0;
+
+	// absolute loads are in network order, as is the test header; with no peer, the source mac loads
+	// turn to loads of 0, which the comparisons always let through
+	const uint16_t mac_load_w = peer ? BPF_LD | BPF_W | BPF_ABS : BPF_LD | BPF_IMM;
+	const uint16_t mac_load_h = peer ? BPF_LD | BPF_H | BPF_ABS : BPF_LD | BPF_IMM;
+
+	sock_filter code[] = {
+		{ BPF_LD  | BPF_H | BPF_ABS, 0, 0, offsetof(ethhdr, h_proto) }, // a = ethertype
+		{ BPF_JMP | BPF_JEQ | BPF_K, 0, 7, frame_proto },
+		{ mac_load_w, 0, 0, peer ? uint32_t(offsetof(ethhdr, h_source)) : 0 },      // a = source mac, octets 0-3
+		{ BPF_JMP | BPF_JEQ | BPF_K, 0, 5, mac_hi },
+		{ mac_load_h, 0, 0, peer ? uint32_t(offsetof(ethhdr, h_source) + 4) : 0 },  // a = source mac, octets 4-5
+		{ BPF_JMP | BPF_JEQ | BPF_K, 0, 3, mac_lo },
+		{ BPF_LD  | BPF_W | BPF_ABS, 0, 0, ETH_HLEN }, // a = magic
+		{ BPF_JMP | BPF_JEQ | BPF_K, 0, 1, wire_magic },
+		{ BPF_RET | BPF_K, 0, 0, ~0U },                // accept the whole frame
+		{ BPF_RET | BPF_K, 0, 0, 0 }                   // drop
+	};
+	sock_fprog prog;
+	prog.len = sizeof(code) / sizeof(code[0]);
+	prog.filter = code;
+
+	if (0 > setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog))) {
+		fprintf(stderr, "error: cannot attach socket filter (errno: %s)\n", strerror(errno));
+		return false;
+	}
+
+	uint8_t drain;
+
+	while (0 <= recv(fd, &drain, sizeof(drain), MSG_DONTWAIT | MSG_TRUNC)) {
+	}
+
+	return true;
+}
+
+// have the kernel demux incoming frames across the sockets of a fanout group by the worker index
+// in their payload; sockets must join in worker order, as that order is what the index selects
+static bool join_fanout(
+	const int fd,
+	const uint16_t group) {
+
+	const int arg = group | PACKET_FANOUT_CBPF << 16;
+
+	if (0 > setsockopt(fd, SOL_PACKET, PACKET_FANOUT, &arg, sizeof(arg))) {
+		fprintf(stderr, "error: cannot join fanout group (errno: %s)\n", strerror(errno));
+		return false;
+	}
+
+	// fanout programs see incoming frames from past the eth header, i.e. from the payload
+	sock_filter code[] = {
+		{ BPF_LD | BPF_B | BPF_ABS, 0, 0, wire_worker_offset }, // a = worker index
+		{ BPF_RET | BPF_A, 0, 0, 0 }                            // return a
+	};
+	sock_fprog prog;
+	prog.len = sizeof(code) / sizeof(code[0]);
+	prog.filter = code;
+
+	if (0 > setsockopt(fd, SOL_PACKET, PACKET_FANOUT_DATA, &prog, sizeof(prog))) {
+		fprintf(stderr, "error: cannot set fanout program (errno: %s)\n", strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
+// socket options in effect, as the kernel has them - buffer sizes come back doubled, for the
+// kernel's bookkeeping, and capped at net.core.wmem_max/rmem_max unless forced
+struct socket_figures {
+	int sndbuf;
+	int rcvbuf;
+	int priority;
+	int qdisc_bypass;
+	int tx_loss;
+
+	void take(const int fd) {
+		const struct {
+			int level;
+			int optname;
+			int* value;
+		} opt[] = {
+			{ SOL_SOCKET, SO_SNDBUF, &sndbuf },
+			{ SOL_SOCKET, SO_RCVBUF, &rcvbuf },
+			{ SOL_SOCKET, SO_PRIORITY, &priority },
+			{ SOL_PACKET, PACKET_QDISC_BYPASS, &qdisc_bypass },
+			{ SOL_PACKET, PACKET_LOSS, &tx_loss }
+		};
+
+		for (size_t i = 0; i < sizeof(opt) / sizeof(opt[0]); ++i) {
+			socklen_t len = sizeof(*opt[i].value);
+
+			if (0 > getsockopt(fd, opt[i].level, opt[i].optname, opt[i].value, &len))
+				*opt[i].value = -1;
+		}
+	}
+};
+
+// parse a mac address, octets in hex separated by colons
+static bool parse_mac(
+	const char* const arg,
+	uint8_t (& mac)[8]) { // output: mac address, last two octets unused
+
+	char tail = '\0';
+
+	return 6 == sscanf(arg, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx%c",
+		&mac[0],
+		&mac[1],
+		&mac[2],
+		&mac[3],
+		&mac[4],
+		&mac[5],
+		&tail);
+}
+
+// parse a comma-separated list of mac addresses, or @file for a file of them - whitespace-separated,
+// # to the end of the line a comment; no address may come twice
+static bool parse_targets(
+	const char* const arg,
+	uint8_t (& peer)[peers_max][8], // output: mac addresses
+	uint32_t& count) {              // output: number of addresses
+
+	char list[4096];
+	count = 0;
+
+	if ('@' == arg[0]) {
+		FILE* const f = fopen(arg + 1, "r");
+
+		if (0 == f) {
+			fprintf(stderr, "error: cannot open target file %s (errno: %s)\n", arg + 1, strerror(errno));
+			return false;
+		}
+
+		size_t len = 0;
+		char line[256];
+
+		while (0 != fgets(line, sizeof(line), f)) {
+			line[strcspn(line, "#\n")] = '\0';
+			len += snprintf(list + len, sizeof(list) - len, "%s ", line);
+
+			if (len >= sizeof(list))
+				break;
+		}
+
+		fclose(f);
+
+		if (len >= sizeof(list))
+			return false;
+	}
+	else if (strlen(arg) < sizeof(list))
+		strcpy(list, arg);
+	else
+		return false;
+
+	char* save = 0;
+
+	for (const char* t = strtok_r(list, ", \t\r", &save); 0 != t; t = strtok_r(0, ", \t\r", &save)) {
+		if (peers_max == count || !parse_mac(t, peer[count]))
+			return false;
+
+		for (uint32_t i = 0; i < count; ++i) {
+			if (0 == memcmp(peer[i], peer[count], ETH_ALEN))
+				return false;
+		}
+
+		++count;
+	}
+
+	return 0 != count;
+}
+
+// parse a vlan id optionally followed by a colon and a comma-separated list of priority code points,
+// the classes of the flows; pcp 0 by default, and no class may come twice
+static bool parse_vlan(
+	const char* const arg,
+	uint32_t& id,             // output: vlan id
+	uint8_t (& pcp)[pcp_max], // output: priority code points
+	uint32_t& count) {        // output: number of classes
+
+	int len = 0;
+	count = 0;
+
+	if (1 != sscanf(arg, "%u%n", &id, &len) || vlan_id_max < id)
+		return false;
+
+	if ('\0' == arg[len]) {
+		pcp[count++] = 0;
+		return true;
+	}
+
+	if (':' != arg[len])
+		return false;
+
+	for (const char* c = arg + len; ':' == *c || ',' == *c; c += len) {
+		unsigned int p = 0;
+
+		if (pcp_max == count || 1 != sscanf(c + 1, "%u%n", &p, &len) || pcp_max <= p)
+			return false;
+
+		++len;
+
+		for (uint32_t i = 0; i < count; ++i) {
+			if (pcp[i] == p)
+				return false;
+		}
+
+		pcp[count++] = uint8_t(p);
+
+		if ('\0' == c[len])
+			return true;
+	}
+
+	return false;
+}
+
+// parse a list of cores, comma-separated cores or ranges thereof, e.g. 2,4-7
+static bool parse_cpus(
+	const char* const arg,
+	int (& cpus)[cpu_list_max], // output: the cores, in order
+	uint32_t& count) {          // output: number of cores
+
+	count = 0;
+
+	for (const char* c = arg;; ++c) {
+		int lo = 0, hi = 0, len = 0;
+
+		if (1 != sscanf(c, "%d%n", &lo, &len))
+			return false;
+
+		c += len;
+		hi = lo;
+
+		if ('-' == *c) {
+			if (1 != sscanf(c + 1, "%d%n", &hi, &len))
+				return false;
+
+			c += 1 + len;
+		}
+
+		if (0 > lo || lo > hi || CPU_SETSIZE <= hi)
+			return false;
+
+		for (int cpu = lo; cpu <= hi; ++cpu) {
+			if (cpu_list_max == count)
+				return false;
+
+			cpus[count++] = cpu;
+		}
+
+		if ('\0' == *c)
+			return true;
+
+		if (',' != *c)
+			return false;
+	}
+}
+
+// parse a suite matrix: default, or axes separated by slashes, each an axis name, = and a list of
+// comma-separated values, e.g. engines=ring,mmsg/sizes=60,1514; axes not given keep their defaults
+static bool parse_suite(
+	const char* const arg,
+	suite_matrix& m) { // output: the matrix
+
+	const uint32_t defaults[suite_axis_count][3] = {
+		{ engine_type_socket, engine_type_ring, engine_type_mmsg },
+		{ uint32_t(frame_min_size), uint32_t(frame_full_size), 0 },
+		{ 1, uint32_t(default_batch), 0 },
+		{ 1, 2, 0 }
+	};
+
+	for (uint32_t a = 0; a < suite_axis_count; ++a) {
+		m.axis[a].count = 0;
+
+		for (uint32_t i = 0; i < 3 && (0 == i || 0 != defaults[a][i]); ++i)
+			m.axis[a].add(defaults[a][i]);
+	}
+
+	if (!strcmp(arg, "default"))
+		return true;
+
+	uint32_t given = 0; // axes given, a bit each
+
+	for (const char* c = arg; '\0' != *c;) {
+		uint32_t a = 0;
+		size_t len = 0;
+
+		for (; a < suite_axis_count; ++a) {
+			len = strlen(suite_axis_name[a]);
+
+			if (!strncmp(c, suite_axis_name[a], len) && '=' == c[len])
+				break;
+		}
+
+		if (suite_axis_count == a || (given & 1 << a))
+			return false;
+
+		given |= 1 << a;
+		m.axis[a].count = 0;
+
+		// values past the = and each comma, up to the next axis
+		for (c += len; '=' == *c || ',' == *c;) {
+			const size_t n = strcspn(++c, ",/");
+			uint32_t v = 0;
+			int end = 0;
+
+			if (suite_engines == a) {
+				while (v < engine_type_count && (strlen(engine_name[v]) != n || strncmp(c, engine_name[v], n)))
+					++v;
+
+				if (engine_type_count == v)
+					return false;
+			}
+			else if (1 != sscanf(c, "%u%n", &v, &end) || size_t(end) != n ||
+				(suite_sizes == a && (frame_min_size > v || frame_max_size < v)) ||
+				(suite_batches == a && (0 == v || batch_max < v)) ||
+				(suite_threads == a && (0 == v || threads_max < v)))
+				return false;
+
+			if (!m.axis[a].add(v))
+				return false;
+
+			c += n;
+		}
+
+		if ('/' == *c && '\0' == *++c)
+			return false;
+	}
+
+	return true;
+}
+
+// parse a rate as a number with an optional k, M or G multiplier and an optional bps or pps unit;
+// bits/s by default
+static bool parse_rate(
+	const char* const arg,
+	double& rate,  // output: rate
+	bool& pps) {   // output: rate is in frames/s
+
+	char unit[8] = "";
+	double value = 0.0;
+
+	if (1 > sscanf(arg, "%lf%7s", &value, unit) || !(0.0 < value))
+		return false;
+
+	const char* u = unit;
+
+	switch (*u) {
+	case 'k':
+		value *= 1e3;
+		++u;
+		break;
+	case 'M':
+		value *= 1e6;
+		++u;
+		break;
+	case 'G':
+		value *= 1e9;
+		++u;
+		break;
+	}
+
+	if (!strcmp(u, "pps"))
+		pps = true;
+	else if ('\0' == *u || !strcmp(u, "bps"))
+		pps = false;
+	else
+		return false;
+
+	rate = value;
+	return true;
+}
+
+// the other end of a session: each peer has a test sequence, and workers, of its own
+struct peer {
+	uint8_t mac[8];          // mac address, last two octets unused
+	uint32_t session_id;     // id stamped on all frames of the session with the peer, never 0
+	uint32_t ipv4;           // transport engines: iface address of the peer, network order, 0 if none
+	uint16_t port;           // transport engines: port of the peer's first worker of the session
+};
+
+// parameters of a run, common to all workers
+struct session {
+	const char* iface_name;  // iface name, cstr
+	size_t iface_namelen;    // iface name length
+	peer peers[peers_max];   // transmitter: the responders to fan out to; responder: the transmitters fanned in from
+	uint32_t peer_count;     // peers of the session; the responder learns them in the handshake
+	uint32_t packet_count;   // frames in the test sequence
+	size_t frame_size;       // size of all frames, header included
+	uint32_t engine;         // engine type
+	size_t batch;            // engine batch; responder: 0 until the handshake, if not given
+	uint32_t queue;          // first iface queue, for engines binding to one
+	uint32_t threads;        // worker count per peer
+	bool transmitter;        // transmitter or responder
+	bool duplex;             // full-duplex streams instead of half-duplex burst/echo
+	bool latency;            // ping-pong one frame at a time instead of burst/echo
+	bool pinned;             // pin workers to cores
+	int cpus[cpu_list_max];  // cores the lanes are pinned to in turn; not part of the handshake
+	uint32_t cpu_count;      // 0 for the default placement, one core per lane
+	int rt_priority;         // SCHED_FIFO priority of the lanes, 0 for the regular policy; not part of the handshake
+	const irq_steering* irqs; // irqs of the iface, steered to a core of choice; 0 if not steering
+	const char* histogram_path; // latency mode: file to dump the round-trip histogram to, cstr, 0 if none
+	int timestamp;           // timestamp source requested, timestamp_none for user-space timing only
+	double rate;             // transmit rate, bits/s on the wire or frames/s; 0 for as fast as possible
+	bool rate_pps;           // rate is in frames/s
+	int rx_timeout;          // ms without frames after which the receiving side gives up on the rest
+	int poll;                // rx_poll_mode: how the receiving side awaits frames; not part of the handshake
+	int sndbuf;              // socket send buffer to ask for, octets; 0 for the default
+	int rcvbuf;              // socket receive buffer to ask for, octets; 0 for the default
+	int priority;            // socket priority of outgoing frames, -1 for the default
+	bool qdisc_bypass;       // outgoing frames skip the qdisc layer
+	bool tx_loss;            // tx ring: skip malformed frames rather than stop at them
+	bool sqpoll;             // uring engine: a kernel thread takes in the requests; not part of the handshake
+	uint32_t ipv4;           // transport engines: iface address, network order, 0 if none; learnt ahead of the handshake
+	bool hugepages;          // frame memory backed by hugepages
+	int payload;             // payload_mode of the frame bodies; responder: -1 until the handshake, if not given
+	bool verify;             // frame bodies carry a CRC32C, checked on receipt
+	bool reflect;            // responder: send the frames received back in place of a stream of its own
+	bool vlan;               // outgoing frames tagged 802.1Q; not part of the handshake
+	uint32_t vlan_id;
+	uint8_t pcp[pcp_max];    // priority classes, the workers of each peer taking them in turn
+	uint32_t pcp_count;
+	uint32_t duration;       // soak mode: s to stream for; 0 for a single test sequence
+	double report_interval;  // soak mode: s between reports
+	uint32_t runs;           // runs per frame size, summarized if more than one
+	uint32_t warmup_runs;    // runs per frame size ahead of those, not counted
+	uint32_t warmup_frames;  // frames per run ahead of the timed ones, a share per worker, not counted
+	bool more;               // another session follows this one, the responder staying for it
+	report* out;             // results output
+	bool perf;               // take system figures around the run: perf counters, irqs, softnet
+	uint32_t perf_mask;      // perf counters available
+	bool perf_user_only;     // perf counters restricted to user space
+	size_t size_min;         // frame sizes, a sweep from size_min to size_max in steps of size_step
+	size_t size_max;
+	size_t size_step;
+	bool target_set;         // peer mac addresses known ahead of the handshake
+};
+
+// workers of the session, over all peers
+static uint32_t workers_of(
+	const session& ss) {
+
+	return ss.threads * ss.peer_count;
+}
+
+// name of the mode of the session, as in the records
+static const char* mode_name(
+	const session& ss) {
+
+	return ss.duration ? "soak" : ss.latency ? "ping-pong" : ss.duplex ? "full-duplex" : "half-duplex";
+}
+
+// headline figure of a run, by the mode of the session: the round-trip time in ping-pong, the
+// bandwidth received in full-duplex, the bandwidth transceived otherwise; better higher but for the
+// round-trip time
+static const char* metric_of(
+	const session& ss,
+	bool& higher_better) { // output: figure better higher
+
+	higher_better = !ss.latency;
+	return ss.latency ? "rtt_p50_us" : ss.duplex ? "rx_bandwidth_bytes_s" : "bandwidth_bytes_s";
+}
+
+// octets of the tag going ahead of each outgoing frame, see engine.h
+static size_t tag_size_of(
+	const session& ss) {
+
+	return ss.vlan ? vlan_tag_size : 0;
+}
+
+// priority code point of the frames of a worker, by its index local to the peer; 0 if untagged
+static uint32_t pcp_of(
+	const session& ss,
+	const uint32_t local) {
+
+	return ss.vlan ? ss.pcp[local % ss.pcp_count] : 0;
+}
+
+// set a socket buffer size beyond the system cap if permitted, within the cap otherwise
+static bool set_buffer(
+	const int fd,
+	const int optname_force, // SO_SNDBUFFORCE or SO_RCVBUFFORCE
+	const int optname,       // SO_SNDBUF or SO_RCVBUF
+	const int size,
+	const char* const name) {
+
+	if (0 <= setsockopt(fd, SOL_SOCKET, optname_force, &size, sizeof(size)))
+		return true;
+
+	if (0 > setsockopt(fd, SOL_SOCKET, optname, &size, sizeof(size))) {
+		fprintf(stderr, "error: cannot set socket %s (errno: %s)\n", name, strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
+// apply the socket options of the session; ahead of the engine setup, as the tx ring takes no
+// change of PACKET_LOSS once set up
+static bool tune_socket(
+	const int fd,
+	const session& ss) {
+
+	if (ss.sndbuf && !set_buffer(fd, SO_SNDBUFFORCE, SO_SNDBUF, ss.sndbuf, "send buffer"))
+		return false;
+
+	if (ss.rcvbuf && !set_buffer(fd, SO_RCVBUFFORCE, SO_RCVBUF, ss.rcvbuf, "receive buffer"))
+		return false;
+
+	if (0 <= ss.priority && 0 > setsockopt(fd, SOL_SOCKET, SO_PRIORITY, &ss.priority, sizeof(ss.priority))) {
+		fprintf(stderr, "error: cannot set socket priority (errno: %s)\n", strerror(errno));
+		return false;
+	}
+
+	const int on = 1;
+
+	if (ss.qdisc_bypass && 0 > setsockopt(fd, SOL_PACKET, PACKET_QDISC_BYPASS, &on, sizeof(on))) {
+		fprintf(stderr, "error: cannot set qdisc bypass (errno: %s)\n", strerror(errno));
+		return false;
+	}
+
+	if (ss.tx_loss && 0 > setsockopt(fd, SOL_PACKET, PACKET_LOSS, &on, sizeof(on))) {
+		fprintf(stderr, "error: cannot set tx loss (errno: %s)\n", strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
+enum lane_role {
+	lane_half_duplex, // send and receive, one after the other
+	lane_tx,          // send only, while the other lane receives
+	lane_rx,          // receive only, while the other lane sends
+	lane_soak_tx,     // soak mode: stream for the duration, while the other lane receives the echoes
+	lane_soak_rx,     // soak mode: receive the echoes
+	lane_soak_echo,   // soak mode: echo the stream
+	lane_reflect      // reflector: send the frames received back as they are
+};
+
+// a worker runs its share of the test sequence on a socket of its own, on one lane (thread) in
+// half-duplex mode, or on a tx and an rx lane in full-duplex mode and on the soak transmitter
+template < class ENGINE_T >
+struct worker : non_copyable {
+	struct lane {
+		worker* w;
+		pthread_t thread;
+		int role;         // lane_role
+		int cpu;          // core the lane is pinned to, -1 if none
+		uint64_t t0;      // lane start and end times
+		uint64_t t1;
+		bool ok;
+		int rt_priority;  // SCHED_FIFO priority of the lane in effect, 0 for none
+		probe_set probes; // instrumented build: counts of the lane
+		perf_set perf;    // perf counters of the lane
+	};
+
+	frame_pool pool;      // frame memory, outliving the engine drawing on it
+	payload_spec body;    // frame bodies
+	ENGINE_T engine;
+	engine_config cfg;
+	sockaddr_ll saddr;
+	int fd;
+	socket_figures sock;  // socket options in effect
+
+	const session* ss;
+	pthread_barrier_t* barrier;
+	const int* launch;    // 1 once all lanes of the run are created, -1 if creating one failed, 0 until then
+	uint32_t index;
+	uint32_t peer;        // index of the peer the worker is testing with
+	uint64_t seq_begin;   // share of the test sequence: [seq_begin, seq_end)
+	uint64_t seq_end;
+	uint64_t warm_begin;  // share of the warm-up frames: [warm_begin, warm_end)
+	uint64_t warm_end;
+	uint32_t session_id;  // session id of the peer, agreed on in the handshake
+
+	lane lanes[2];
+	uint32_t lane_count;
+	uint32_t rx_going;    // full-duplex: rx lane has received its first frame, or given up
+	seq_tracker tracker;  // frames received
+	seq_tracker warm;     // warm-up frames received
+	histogram* rtt;       // latency mode: round-trip times
+	histogram* wire;      // latency mode, timestamping: wire-side round-trip times
+	histogram* gap;       // timestamping: wire-side gaps between incoming frames
+	double interval;      // paced mode: ns from one frame to the next
+
+	seq_window window;    // soak mode: frames received
+	soak_counters counters; // soak mode: figures of the rx lane, published
+	soak_rtt soak;        // soak mode, transmitter: round-trip times of the rx lane
+	uint64_t sent __attribute__ ((aligned(64))); // soak mode: frames sent, published by the tx lane
+	uint32_t tx_done;     // soak mode: tx lane is done
+
+	worker()
+	: fd(-1)
+	, ss(0)
+	, barrier(0)
+	, launch(0)
+	, index(0)
+	, peer(0)
+	, seq_begin(0)
+	, seq_end(0)
+	, warm_begin(0)
+	, warm_end(0)
+	, session_id(0)
+	, lane_count(0)
+	, rx_going(0)
+	, rtt(0)
+	, wire(0)
+	, gap(0)
+	, interval(0.0)
+	, sent(0)
+	, tx_done(0) {
+		memset(lanes, 0, sizeof(lanes));
+		memset(&counters, 0, sizeof(counters));
+		memset(&soak, 0, sizeof(soak));
+	}
+
+	~worker() {
+		if (0 <= fd)
+			close(fd);
+	}
+};
+
+// warm-up pass of a lane: the worker's share of the warm-up frames, of a session of their own, the
+// way of the test, on the sockets and frame memory of the test; the responder's full-duplex stream
+// sets off only once its rx lane is done, rather than at the first frame, so that the transmitter
+// comes out of the warm-up no sooner than the responder
+template < class ENGINE_T >
+static bool warm_up(
+	typename worker< ENGINE_T >::lane& l,
+	worker< ENGINE_T >& w) {
+
+	const session& ss = *w.ss;
+	const int first_wait = ss.transmitter ? first_frame_timeouts : -1;
+	uint32_t session = w.session_id ^ wire_warmup_session;
+	uint64_t t0 = 0;
+	uint32_t going = 0;
+
+	switch (l.role) {
+	case lane_half_duplex:
+		if (ss.latency) {
+			return ss.transmitter ?
+				ping_sequence(w.engine, w.body, ss.frame_size, w.warm_begin, w.warm_end, session, w.warm, *w.rtt, w.wire) :
+				echo_sequence(w.engine, w.body, ss.frame_size, session, w.warm);
+		}
+
+		if (ss.transmitter) {
+			return send_sequence(w.engine, w.body, w.warm_begin, w.warm_end, session, w.interval) &&
+			       recv_sequence(w.engine, w.body, ss.frame_size, true, session, w.warm, first_wait, t0, going, 0);
+		}
+
+		return recv_sequence(w.engine, w.body, ss.frame_size, false, session, w.warm, first_wait, t0, going, 0) &&
+		       send_sequence(w.engine, w.body, w.warm_begin, w.warm_end, session, w.interval);
+
+	case lane_tx:
+		if (!ss.transmitter) {
+			while (!__atomic_load_n(&w.rx_going, __ATOMIC_ACQUIRE))
+				sched_yield();
+		}
+
+		return send_sequence(w.engine, w.body, w.warm_begin, w.warm_end, session, w.interval);
+
+	case lane_rx: {
+		const bool ok = recv_sequence(w.engine, w.body, ss.frame_size, ss.transmitter, session, w.warm, first_wait, t0, going, 0);
+		__atomic_store_n(&w.rx_going, 1, __ATOMIC_RELEASE);
+		return ok;
+	}
+
+	case lane_reflect:
+		return reflect_sequence(w.engine, w.body, ss.frame_size, session, w.window, w.warm_end - w.warm_begin);
+	}
+
+	return true;
+}
+
+template < class ENGINE_T >
+static void* lane_main(
+	void* arg) {
+
+	typename worker< ENGINE_T >::lane& l = *reinterpret_cast< typename worker< ENGINE_T >::lane* >(arg);
+	worker< ENGINE_T >& w = *l.w;
+
+	// the barriers count on all lanes, so set off only once all are there; none are, should one fail
+	int launch;
+
+	while (0 == (launch = __atomic_load_n(w.launch, __ATOMIC_ACQUIRE)))
+		sched_yield();
+
+	if (0 > launch) {
+		l.ok = false;
+		return 0;
+	}
+
+	if (0 <= l.cpu) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(l.cpu, &set);
+
+		if (0 != pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) {
+			fprintf(stderr, "warning: cannot pin thread %u to cpu %d\n", w.index, l.cpu);
+			l.cpu = -1;
+		}
+	}
+
+	const int err = set_rt_priority(w.ss->rt_priority);
+
+	if (0 != err)
+		fprintf(stderr, "warning: cannot set real-time priority %d of thread %u (errno: %s)\n", w.ss->rt_priority, w.index, strerror(err));
+
+	l.rt_priority = rt_priority_of_self();
+
+	pthread_barrier_wait(w.barrier);
+
+	// the warm-up, if any, then all lanes start over together, the first lane of each worker clearing
+	// what the warm-up left behind in between
+	bool warm = true;
+
+	if (0 != w.ss->warmup_frames) {
+		warm = w.warm_begin == w.warm_end || warm_up(l, w);
+		pthread_barrier_wait(w.barrier);
+
+		if (&l == w.lanes) {
+			w.rx_going = 0;
+			w.window.reset();
+
+			if (0 != w.rtt)
+				w.rtt->reset();
+
+			if (0 != w.wire)
+				w.wire->reset();
+
+			if (0 != w.gap)
+				w.gap->reset();
+		}
+
+		pthread_barrier_wait(w.barrier);
+	}
+
+	probe_begin();
+
+	if (w.ss->perf)
+		l.perf.begin(w.ss->perf_mask, w.ss->perf_user_only);
+
+	// the responder awaits the transmitter indefinitely, the transmitter gives the responder a
+	// couple of rx timeouts to answer
+	const int first_wait = w.ss->transmitter ? first_frame_timeouts : -1;
+	uint64_t t0 = 0;
+
+	switch (l.role) {
+	case lane_half_duplex:
+		l.t0 = timer_ns();
+
+		if (w.ss->latency) {
+			l.ok = w.ss->transmitter ?
+				ping_sequence(w.engine, w.body, w.ss->frame_size, w.seq_begin, w.seq_end, w.session_id, w.tracker, *w.rtt, w.wire) :
+				echo_sequence(w.engine, w.body, w.ss->frame_size, w.session_id, w.tracker);
+		}
+		else if (w.ss->transmitter) {
+			l.ok = send_sequence(w.engine, w.body, w.seq_begin, w.seq_end, w.session_id, w.interval) &&
+			       recv_sequence(w.engine, w.body, w.ss->frame_size, true, w.session_id, w.tracker, first_wait, t0, w.rx_going, w.gap);
+		}
+		else {
+			l.ok = recv_sequence(w.engine, w.body, w.ss->frame_size, false, w.session_id, w.tracker, first_wait, t0, w.rx_going, w.gap) &&
+			       send_sequence(w.engine, w.body, w.seq_begin, w.seq_end, w.session_id, w.interval);
+		}
+		break;
+
+	case lane_tx:
+		// the responder starts its stream once the transmitter's stream has reached it
+		if (!w.ss->transmitter) {
+			while (!__atomic_load_n(&w.rx_going, __ATOMIC_ACQUIRE))
+				sched_yield();
+		}
+
+		l.t0 = timer_ns();
+		l.ok = send_sequence(w.engine, w.body, w.seq_begin, w.seq_end, w.session_id, w.interval);
+		break;
+
+	case lane_rx:
+		// the transmitter's rx span starts along with its tx span, the responder's at its first frame
+		if (w.ss->transmitter)
+			l.t0 = timer_ns();
+
+		l.ok = recv_sequence(w.engine, w.body, w.ss->frame_size, w.ss->transmitter, w.session_id, w.tracker, first_wait, l.t0, w.rx_going, w.gap);
+
+		// nothing received - an empty span
+		if (0 == l.t0)
+			l.t0 = timer_ns();
+		__atomic_store_n(&w.rx_going, 1, __ATOMIC_RELEASE);
+		break;
+
+	case lane_soak_tx:
+		l.t0 = timer_ns();
+		l.ok = soak_send(w.engine, w.body, w.session_id, w.interval, l.t0 + uint64_t(w.ss->duration) * 1000000000ULL, w.sent);
+		__atomic_store_n(&w.tx_done, 1, __ATOMIC_RELEASE);
+		break;
+
+	case lane_soak_rx:
+		l.t0 = timer_ns();
+		l.ok = soak_recv(w.engine, w.body, w.ss->frame_size, w.session_id, w.window, w.counters, w.soak, w.tx_done);
+		__atomic_store_n(&w.soak.done, 1, __ATOMIC_RELEASE);
+		break;
+
+	case lane_soak_echo:
+		l.t0 = timer_ns();
+		l.ok = echo_sequence(w.engine, w.body, w.ss->frame_size, w.session_id, w.window);
+		break;
+
+	case lane_reflect:
+		l.t0 = timer_ns();
+		l.ok = reflect_sequence(w.engine, w.body, w.ss->frame_size, w.session_id, w.window, 0);
+		break;
+	}
+
+	l.t1 = timer_ns();
+	l.ok = l.ok && warm;
+	probe_end(l.probes);
+
+	if (w.ss->perf)
+		l.perf.end();
+
+	return 0;
+}
+
+// print the span, byte count, bandwidth and frame rate of one or more lanes
+static void print_figures(
+	report& out,
+	const char* const what,  // preposition for the figures, cstr; key prefix of the record fields
+	const char* const bytes, // noun for the byte count, cstr
+	const uint64_t dt,
+	const double octets,     // payload octets
+	const double frames) {
+
+	if (!out.text()) {
+		if (0 != dt) {
+			const double s = double(dt) * 1e-9;
+
+			out.f64(what, "elapsed_s", s);
+			out.f64(what, "bytes", octets);
+			out.f64(what, "bandwidth_bytes_s", octets / s);
+			out.f64(what, "packet_rate_frames_s", frames / s);
+		}
+		else
+			out.flag("failed", true);
+
+		return;
+	}
+
+	if (0 != dt) {
+		const double s = double(dt) * 1e-9;
+
+		printf("%selapsed time %f s\n%s %.0f bytes\n%sbandwidth %f bytes/s\n%spacket rate %f frames/s\n",
+				what,
+				s,
+				bytes,
+				octets,
+				what,
+				octets / s,
+				what,
+				frames / s);
+	}
+	else
+		printf("session failed\n");
+}
+
+// print the payload rate of the frames received once, in sequence or not
+static void print_goodput(
+	report& out,
+	const uint64_t dt,
+	const double octets) {
+
+	if (0 == dt)
+		return;
+
+	if (out.text())
+		printf("goodput %f bytes/s\n", octets / (double(dt) * 1e-9));
+	else
+		out.f64("goodput_bytes_s", octets / (double(dt) * 1e-9));
+}
+
+// print the frame accounting of the receiving side
+static void print_loss(
+	report& out,
+	const seq_tracker& tracker,
+	const uint64_t expected,
+	const bool verify) { // payloads verified, corrupt frames counted
+
+	if (!out.text()) {
+		out.u64("received", tracker.received);
+		out.u64("lost", expected - tracker.received);
+		out.u64("duplicate", tracker.duplicate);
+		out.u64("reordered", tracker.reordered);
+		out.u64("foreign", tracker.foreign);
+
+		if (verify)
+			out.u64("corrupt", tracker.corrupt);
+		return;
+	}
+
+	printf("received %llu frames, lost %llu, duplicate %llu, reordered %llu, foreign %llu",
+			(unsigned long long) tracker.received,
+			(unsigned long long) (expected - tracker.received),
+			(unsigned long long) tracker.duplicate,
+			(unsigned long long) tracker.reordered,
+			(unsigned long long) tracker.foreign);
+
+	if (verify)
+		printf(", corrupt %llu", (unsigned long long) tracker.corrupt);
+
+	printf("\n");
+}
+
+// print the min, percentiles and max of a histogram of ns values
+static void print_percentiles(
+	report& out,
+	const char* const name, // name of the values, cstr; key prefix of the record fields
+	const histogram& h) {
+
+	static const double pct[] = { 50.0, 99.0, 99.9, 99.99 };
+	static const char* const pct_name[] = { "p50", "p99", "p99.9", "p99.99" };
+	static const char* const pct_key[] = { "_p50_us", "_p99_us", "_p99_9_us", "_p99_99_us" };
+
+	if (!out.text()) {
+		out.f64(name, "_min_us", double(h.lowest()) * 1e-3);
+
+		for (size_t i = 0; i < sizeof(pct) / sizeof(pct[0]); ++i)
+			out.f64(name, pct_key[i], double(h.percentile(pct[i])) * 1e-3);
+
+		out.f64(name, "_max_us", double(h.highest()) * 1e-3);
+		return;
+	}
+
+	printf("%s min %.3f us\n", name, double(h.lowest()) * 1e-3);
+
+	for (size_t i = 0; i < sizeof(pct) / sizeof(pct[0]); ++i)
+		printf("%s %s %.3f us\n", name, pct_name[i], double(h.percentile(pct[i])) * 1e-3);
+
+	printf("%s max %.3f us\n", name, double(h.highest()) * 1e-3);
+}
+
+// print the wire-side figures from timestamping, if there are any
+static void print_wire(
+	report& out,
+	const char* const name, // name of the values, cstr
+	const histogram& h) {
+
+	if (0 == h.total()) {
+		if (out.text())
+			printf("%s: no timestamps from the engine\n", name);
+
+		return;
+	}
+
+	print_percentiles(out, name, h);
+}
+
+// print the round-trip time percentiles, optionally dump the full distribution to a file
+static bool print_latency(
+	report& out,
+	const histogram& rtt,
+	const uint64_t dt,
+	const char* const path) {
+
+	if (out.text()) {
+		printf("elapsed time %f s\nround trips %llu\n",
+				double(dt) * 1e-9,
+				(unsigned long long) rtt.total());
+	}
+	else {
+		out.f64("elapsed_s", double(dt) * 1e-9);
+		out.u64("round_trips", rtt.total());
+	}
+
+	print_percentiles(out, "rtt", rtt);
+
+	if (0 == path)
+		return true;
+
+	FILE* const f = fopen(path, "w");
+
+	if (0 == f) {
+		fprintf(stderr, "error: cannot open histogram file %s (errno: %s)\n", path, strerror(errno));
+		return false;
+	}
+
+	rtt.dump(f, 1e3);
+	fclose(f);
+	return true;
+}
+
+// write a mac address in the usual notation into s, room for 3 * ETH_ALEN chars; return its length
+static int format_mac(
+	char* const s,
+	const uint8_t* const mac) {
+
+	return snprintf(s, 3 * ETH_ALEN, "%02x:%02x:%02x:%02x:%02x:%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
+
+// start a record of the machine-readable results with the metadata of the run
+static void put_meta(
+	report& out,
+	const char* const kind, // record kind, cstr
+	const session& ss,
+	const int peer) {       // index of the peer the record is about, -1 for all peers
+
+	if (out.text())
+		return;
+
+	char host[256] = "";
+	gethostname(host, sizeof(host) - 1);
+
+	// the target, or the targets, space-separated
+	char target[peers_max * 3 * ETH_ALEN];
+
+	for (uint32_t i = 0, len = 0; i < ss.peer_count; ++i) {
+		if (0 <= peer && uint32_t(peer) != i)
+			continue;
+
+		len += snprintf(target + len, sizeof(target) - len, "%s", 0 == len ? "" : " ");
+		len += format_mac(target + len, ss.peers[i].mac);
+	}
+
+	out.begin(kind);
+	out.str("host", host);
+	out.u64("time", uint64_t(time(0)));
+	out.str("role", ss.transmitter ? "transmitter" : "responder");
+	out.str("interface", ss.iface_name);
+	out.str("target", target);
+
+	if (0 <= peer || 1 == ss.peer_count)
+		out.u64("session", ss.peers[0 <= peer ? peer : 0].session_id);
+
+	out.u64("peers", ss.peer_count);
+	out.str("engine", engine_name[ss.engine]);
+	out.u64("batch", ss.batch);
+	out.u64("queue", ss.queue);
+	out.u64("threads", ss.threads);
+	out.flag("pinned", ss.pinned);
+	out.str("mode", mode_name(ss));
+	out.str("timestamps", timestamp_name[ss.timestamp]);
+	out.u64("frame_size", ss.frame_size);
+	out.u64("packet_count", ss.packet_count);
+	out.f64("rate", ss.rate);
+	out.str("rate_unit", ss.rate_pps ? "frames/s" : "bits/s");
+	out.u64("rx_timeout_ms", uint64_t(ss.rx_timeout));
+	out.str("poll", rx_poll_name[ss.poll]);
+	out.flag("sqpoll", ss.sqpoll);
+	out.flag("hugepages", ss.hugepages);
+	out.str("payload", payload_name[ss.payload]);
+	out.flag("verify", ss.verify);
+	out.flag("reflect", ss.reflect);
+
+	// the priority classes, comma-separated
+	char pcp[2 * pcp_max] = "";
+
+	for (uint32_t i = 0, len = 0; ss.vlan && i < ss.pcp_count; ++i)
+		len += snprintf(pcp + len, sizeof(pcp) - len, "%s%u", 0 == i ? "" : ",", ss.pcp[i]);
+
+	out.i64("vlan", ss.vlan ? int64_t(ss.vlan_id) : -1);
+	out.str("vlan_pcp", pcp);
+	out.u64("duration_s", ss.duration);
+	out.u64("warmup_frames", ss.warmup_frames);
+}
+
+// add the socket options in effect to a run record, -1 for those unknown
+static void put_socket(
+	report& out,
+	const socket_figures& sock) {
+
+	out.i64("sndbuf", sock.sndbuf);
+	out.i64("rcvbuf", sock.rcvbuf);
+	out.i64("priority", sock.priority);
+	out.i64("qdisc_bypass", sock.qdisc_bypass);
+	out.i64("tx_loss", sock.tx_loss);
+}
+
+// print the placement of the run in effect: the cores of all lanes, in worker order, -1 for none, their
+// real-time priorities, 0 for none, and, if steering, the irqs of the iface with the cores taking them
+template < class ENGINE_T >
+static void print_placement(
+	report& out,
+	const session& ss,
+	const worker< ENGINE_T >* const w,
+	const uint32_t workers,
+	const uint32_t lane_count) {
+
+	char cpus[cpu_list_max * 6 + 1] = "";
+	char prio[cpu_list_max * 4 + 1] = "";
+	char irqs[1024] = "";
+
+	for (uint32_t i = 0, len = 0, plen = 0; i < workers; ++i) {
+		for (uint32_t j = 0; j < lane_count; ++j) {
+			len += snprintf(cpus + len, sizeof(cpus) - len, "%s%d", 0 == len ? "" : " ", w[i].lanes[j].cpu);
+			plen += snprintf(prio + plen, sizeof(prio) - plen, "%s%d", 0 == plen ? "" : " ", w[i].lanes[j].rt_priority);
+		}
+	}
+
+	if (0 != ss.irqs)
+		ss.irqs->describe(irqs, sizeof(irqs));
+
+	if (out.text()) {
+		printf("placement: cpus %s, rt priority %s%s%s\n", cpus, prio, 0 != ss.irqs ? ", irqs " : "", irqs);
+		return;
+	}
+
+	out.str("cpus", cpus);
+	out.str("rt_priority", prio);
+	out.str("irqs", irqs);
+}
+
+// span of the lanes of the specified workers, per lane: from the earliest start to the latest end
+template < class ENGINE_T >
+static void lane_span(
+	const worker< ENGINE_T >* const w,
+	const uint32_t count,
+	uint64_t (& t0)[2],  // output: start of each lane
+	uint64_t (& t1)[2]) { // output: end of each lane
+
+	for (uint32_t j = 0; j < 2; ++j) {
+		t0[j] = w[0].lanes[j].t0;
+		t1[j] = w[0].lanes[j].t1;
+
+		for (uint32_t i = 1; i < count; ++i) {
+			t0[j] = t0[j] < w[i].lanes[j].t0 ? t0[j] : w[i].lanes[j].t0;
+			t1[j] = t1[j] > w[i].lanes[j].t1 ? t1[j] : w[i].lanes[j].t1;
+		}
+	}
+}
+
+// soak mode: sum up the figures the workers have published so far
+template < class ENGINE_T >
+static void soak_figures(
+	worker< ENGINE_T >* const w,
+	const uint32_t count,
+	uint64_t& sent,      // output: frames sent
+	seq_window& sum) {   // output: figures of the rx lanes; bitmap untouched
+
+	sent = 0;
+	sum.top = 0;
+	sum.received = 0;
+	sum.duplicate = 0;
+	sum.reordered = 0;
+	sum.late = 0;
+	sum.foreign = 0;
+	sum.corrupt = 0;
+
+	for (uint32_t i = 0; i < count; ++i) {
+		seq_window snap;
+		w[i].counters.load(snap);
+
+		sent += __atomic_load_n(&w[i].sent, __ATOMIC_RELAXED);
+		sum.top += snap.top;
+		sum.received += snap.received;
+		sum.duplicate += snap.duplicate;
+		sum.reordered += snap.reordered;
+		sum.late += snap.late;
+		sum.foreign += snap.foreign;
+		sum.corrupt += snap.corrupt;
+	}
+}
+
+// soak mode: report the figures of each interval while the lanes stream, until all are done; the
+// reporter only ever reads what the lanes publish, and collects their round-trip times off the hot
+// path; the round-trip times of all intervals add up in total
+template < class ENGINE_T >
+static void soak_report(
+	worker< ENGINE_T >* const w,
+	const session& ss,
+	pthread_barrier_t& barrier,
+	histogram& part,    // room for the round-trip times of an interval
+	histogram& total) { // output: round-trip times of all intervals
+
+	pthread_barrier_wait(&barrier);
+
+	const uint64_t t0 = timer_ns();
+	const uint64_t step = uint64_t(ss.report_interval * 1e9);
+	const double octets_per_frame = double(ss.frame_size - ETH_HLEN);
+	uint64_t t_prev = t0;
+	uint64_t sent_prev = 0;
+	seq_window prev;
+	prev.reset();
+	total.reset();
+
+	for (uint64_t due = t0 + step;; due += step) {
+		bool done = false;
+
+		for (;;) {
+			done = true;
+
+			for (uint32_t i = 0; i < workers_of(ss); ++i)
+				done = done && __atomic_load_n(&w[i].soak.done, __ATOMIC_ACQUIRE);
+
+			const uint64_t now = timer_ns();
+
+			if (done || now >= due)
+				break;
+
+			// wake up often enough to notice the lanes finishing
+			const uint64_t left_us = (due - now) / 1000;
+			usleep(useconds_t(left_us < 10000 ? left_us : 10000));
+		}
+
+		part.reset();
+
+		for (uint32_t i = 0; i < workers_of(ss); ++i)
+			w[i].soak.collect(part);
+
+		uint64_t sent;
+		seq_window sum;
+		soak_figures(w, workers_of(ss), sent, sum);
+
+		const uint64_t t = timer_ns();
+		const double s = double(t - t_prev) * 1e-9;
+		const uint64_t received = sum.received - prev.received;
+		const uint64_t lost = sum.lost() - prev.lost();
+
+		// the lanes finishing past a report leave nothing more to tell
+		if (done && sent == sent_prev && received == 0 && 0 == part.total())
+			break;
+
+		report& out = *ss.out;
+
+		if (out.text()) {
+			printf("interval %.3f-%.3f s: tx packet rate %.0f frames/s, rx bandwidth %.0f bytes/s, rx packet rate %.0f frames/s, lost %lld",
+					double(t_prev - t0) * 1e-9,
+					double(t - t0) * 1e-9,
+					double(sent - sent_prev) / s,
+					octets_per_frame * double(received) / s,
+					double(received) / s,
+					(long long) lost); // may go negative as reordered frames turn up
+
+			if (0 != part.total()) {
+				printf(", rtt p50 %.3f us, p99 %.3f us, p99.9 %.3f us, max %.3f us",
+						double(part.percentile(50.0)) * 1e-3,
+						double(part.percentile(99.0)) * 1e-3,
+						double(part.percentile(99.9)) * 1e-3,
+						double(part.highest()) * 1e-3);
+			}
+
+			printf("\n");
+			fflush(stdout);
+		}
+		else {
+			put_meta(out, "interval", ss, -1);
+			out.f64("begin_s", double(t_prev - t0) * 1e-9);
+			out.f64("end_s", double(t - t0) * 1e-9);
+			out.f64("tx_packet_rate_frames_s", double(sent - sent_prev) / s);
+			out.f64("rx_bandwidth_bytes_s", octets_per_frame * double(received) / s);
+			out.f64("rx_packet_rate_frames_s", double(received) / s);
+			out.i64("lost", int64_t(lost));
+
+			if (0 != part.total())
+				print_percentiles(out, "rtt", part);
+
+			out.end();
+		}
+
+		total.add(part);
+		t_prev = t;
+		sent_prev = sent;
+		prev = sum;
+
+		if (done)
+			break;
+	}
+}
+
+// instrumented build: print the engine call timings and syscall outcomes over all lanes, along with
+// the cycles spent per frame moved
+template < class ENGINE_T >
+static void print_probes(
+	report& out,
+	worker< ENGINE_T >* const w,
+	const uint32_t count,
+	const uint32_t lane_count) {
+
+	probe_set total;
+	total.reset();
+
+	for (uint32_t i = 0; i < count; ++i) {
+		for (uint32_t j = 0; j < lane_count; ++j)
+			total.add(w[i].lanes[j].probes);
+	}
+
+	for (size_t i = 0; i < probe_call_count; ++i) {
+		if (0 == total.calls[i])
+			continue;
+
+		const double calls = double(total.calls[i]);
+
+		if (out.text()) {
+			printf("probe %s: calls %llu, frames %llu, %.1f ns/call, %.1f cycles/call, total %.3f ms\n",
+					probe_call_name[i],
+					(unsigned long long) total.calls[i],
+					(unsigned long long) total.frames[i],
+					double(total.ns[i]) / calls,
+					double(total.cycles[i]) / calls,
+					double(total.ns[i]) * 1e-6);
+		}
+		else {
+			char prefix[32];
+			snprintf(prefix, sizeof(prefix), "probe_%s_", probe_call_name[i]);
+
+			out.u64(prefix, "calls", total.calls[i]);
+			out.u64(prefix, "frames", total.frames[i]);
+			out.f64(prefix, "ns_per_call", double(total.ns[i]) / calls);
+			out.f64(prefix, "cycles_per_call", double(total.cycles[i]) / calls);
+			out.f64(prefix, "total_ms", double(total.ns[i]) * 1e-6);
+		}
+	}
+
+	// frames moved either way, the tx ones when committed, the rx ones when acquired
+	const uint64_t frames = total.frames[probe_tx_commit] + total.frames[probe_rx_acquire];
+	const double per_frame = frames ? double(total.span_cycles) / double(frames) : 0.0;
+
+	if (out.text()) {
+		printf("probe events:");
+
+		for (size_t i = 0; i < probe_event_count; ++i)
+			printf("%s %s %llu", 0 == i ? "" : ",", probe_event_name[i], (unsigned long long) total.events[i]);
+
+		printf("\ncycles per frame %.1f\n", per_frame);
+	}
+	else {
+		for (size_t i = 0; i < probe_event_count; ++i)
+			out.u64("probe_", probe_event_name[i], total.events[i]);
+
+		out.f64("cycles_per_frame", per_frame);
+	}
+}
+
+// system figures of a run, before and after
+struct system_figures {
+	irq_snapshot irq[2];
+	softnet_snapshot softnet[2];
+	bool irq_valid;
+	bool softnet_valid;
+};
+
+// print the perf counters over all lanes and the system figures, totals and per frame moved
+template < class ENGINE_T >
+static void print_system(
+	report& out,
+	const session& ss,
+	worker< ENGINE_T >* const w,
+	const uint32_t lane_count,
+	const system_figures& sys,
+	const uint64_t frames) { // frames moved either way
+
+	const double per = frames ? 1.0 / double(frames) : 0.0;
+
+	for (int i = 0; i < perf_counter_count; ++i) {
+		if (!(ss.perf_mask & 1U << i))
+			continue;
+
+		uint64_t v = 0;
+
+		for (uint32_t j = 0; j < workers_of(ss); ++j) {
+			for (uint32_t k = 0; k < lane_count; ++k)
+				v += w[j].lanes[k].perf.value[i];
+		}
+
+		if (out.text())
+			printf("perf %s %llu, %.3f per frame\n", perf_counter_name[i], (unsigned long long) v, double(v) * per);
+		else {
+			char key[64];
+			snprintf(key, sizeof(key), "%s per frame", perf_counter_name[i]);
+
+			out.u64("perf ", perf_counter_name[i], v);
+			out.f64("perf ", key, double(v) * per);
+		}
+	}
+
+	if (sys.irq_valid) {
+		const irq_snapshot& a = sys.irq[0];
+		const irq_snapshot& b = sys.irq[1];
+		uint64_t total = 0;
+		char list[irq_snapshot::irq_max * 32] = "";
+
+		for (uint32_t i = 0, len = 0; i < b.irq_count; ++i) {
+			const uint64_t n = b.count[i] - a.count_of(b.irq[i]);
+			total += n;
+
+			if (len < sizeof(list))
+				len += snprintf(list + len, sizeof(list) - len, "%s%s:%llu", 0 == len ? "" : " ", b.irq[i], (unsigned long long) n);
+		}
+
+		if (out.text()) {
+			if (0 == b.irq_count)
+				printf("irqs: none of iface %s\n", ss.iface_name);
+			else
+				printf("irqs %llu, %.3f per frame (%s)\n", (unsigned long long) total, double(total) * per, list);
+		}
+		else {
+			out.u64("irqs", total);
+			out.f64("irqs_per_frame", double(total) * per);
+			out.str("irq_list", list);
+		}
+	}
+
+	if (sys.softnet_valid) {
+		const softnet_snapshot& a = sys.softnet[0];
+		const softnet_snapshot& b = sys.softnet[1];
+
+		if (out.text()) {
+			printf("softnet processed %llu, dropped %llu, time squeeze %llu\n",
+					(unsigned long long) (b.processed - a.processed),
+					(unsigned long long) (b.dropped - a.dropped),
+					(unsigned long long) (b.time_squeeze - a.time_squeeze));
+		}
+		else {
+			out.u64("softnet_processed", b.processed - a.processed);
+			out.u64("softnet_dropped", b.dropped - a.dropped);
+			out.u64("softnet_time_squeeze", b.time_squeeze - a.time_squeeze);
+		}
+	}
+}
+
+// soak mode: print the totals over the whole duration
+template < class ENGINE_T >
+static void print_soak(
+	worker< ENGINE_T >* const w,
+	const session& ss,
+	const histogram& rtt,
+	const system_figures& sys) {
+
+	uint64_t t0[2];
+	uint64_t t1[2];
+	uint64_t sent;
+	seq_window sum;
+
+	// frames still due once the stream has dried up are lost, tail included
+	const double octets_per_frame = double(ss.frame_size - ETH_HLEN);
+	report& out = *ss.out;
+
+	// fan-out and fan-in: the totals of each peer ahead of those over all peers
+	for (uint32_t k = 0; k < ss.peer_count && 1 < ss.peer_count; ++k) {
+		worker< ENGINE_T >* const p = w + k * ss.threads;
+
+		lane_span(p, ss.threads, t0, t1);
+		soak_figures(p, ss.threads, sent, sum);
+
+		const double s_tx = double(t1[0] - t0[0]) * 1e-9;
+		const double s_rx = double(t1[1] - t0[1]) * 1e-9;
+
+		if (out.text()) {
+			char mac[3 * ETH_ALEN];
+			format_mac(mac, ss.peers[k].mac);
+
+			printf("peer %s: tx packet rate %.0f frames/s, rx packet rate %.0f frames/s, sent %llu frames, received %llu, lost %llu\n",
+					mac,
+					0.0 < s_tx ? double(sent) / s_tx : 0.0,
+					0.0 < s_rx ? double(sum.received) / s_rx : 0.0,
+					(unsigned long long) sent,
+					(unsigned long long) sum.received,
+					(unsigned long long) (sent - sum.received));
+			continue;
+		}
+
+		put_meta(out, "peer", ss, int(k));
+		print_figures(out, "tx ", "transmitted", t1[0] - t0[0], octets_per_frame * double(sent), double(sent));
+		print_figures(out, "rx ", "received", t1[1] - t0[1], octets_per_frame * double(sum.received), double(sum.received));
+		out.u64("sent", sent);
+		out.u64("received", sum.received);
+		out.u64("lost", sent - sum.received);
+		out.end();
+	}
+
+	lane_span(w, workers_of(ss), t0, t1);
+	soak_figures(w, workers_of(ss), sent, sum);
+
+	put_meta(out, "run", ss, -1);
+	put_socket(out, w[0].sock);
+	print_figures(out, "tx ", "transmitted", t1[0] - t0[0], octets_per_frame * double(sent), double(sent));
+	print_figures(out, "rx ", "received", t1[1] - t0[1], octets_per_frame * double(sum.received), double(sum.received));
+
+	if (out.text()) {
+		printf("sent %llu frames, received %llu, lost %llu, duplicate %llu, reordered %llu, late %llu, foreign %llu",
+				(unsigned long long) sent,
+				(unsigned long long) sum.received,
+				(unsigned long long) (sent - sum.received),
+				(unsigned long long) sum.duplicate,
+				(unsigned long long) sum.reordered,
+				(unsigned long long) sum.late,
+				(unsigned long long) sum.foreign);
+
+		if (ss.verify)
+			printf(", corrupt %llu", (unsigned long long) sum.corrupt);
+
+		printf("\n");
+	}
+	else {
+		out.u64("sent", sent);
+		out.u64("received", sum.received);
+		out.u64("lost", sent - sum.received);
+		out.u64("duplicate", sum.duplicate);
+		out.u64("reordered", sum.reordered);
+		out.u64("late", sum.late);
+		out.u64("foreign", sum.foreign);
+
+		if (ss.verify)
+			out.u64("corrupt", sum.corrupt);
+	}
+
+	if (0 != rtt.total())
+		print_percentiles(out, "rtt", rtt);
+
+	if (ss.perf)
+		print_system(out, ss, w, 2, sys, sent + sum.received);
+
+#if BANDW_INSTRUMENT
+	print_probes(out, w, workers_of(ss), 2);
+
+#endif
+	out.end();
+}
+
+// add the histograms of one worker to those of another
+template < class ENGINE_T >
+static void add_histograms(
+	worker< ENGINE_T >& to,
+	const worker< ENGINE_T >& from) {
+
+	if (0 != to.rtt)
+		to.rtt->add(*from.rtt);
+	if (0 != to.wire)
+		to.wire->add(*from.wire);
+	if (0 != to.gap)
+		to.gap->add(*from.gap);
+}
+
+// fan-out and fan-in: print the figures of the workers of one peer, their histograms added up in
+// the first of them
+template < class ENGINE_T >
+static void print_peer(
+	report& out,
+	const session& ss,
+	worker< ENGINE_T >* const w, // workers of the peer
+	const uint32_t k) {          // index of the peer
+
+	uint64_t t0[2];
+	uint64_t t1[2];
+	seq_tracker total;
+
+	lane_span(w, ss.threads, t0, t1);
+
+	for (uint32_t i = 0; i < ss.threads; ++i)
+		total.add(w[i].tracker);
+
+	const double frames = double(ss.packet_count);
+	const double octets = double(ss.frame_size - ETH_HLEN) * frames;
+	const double frames_rx = double(total.received);
+	const double octets_rx = double(ss.frame_size - ETH_HLEN) * frames_rx;
+	const uint64_t lost = ss.packet_count - total.received;
+
+	if (out.text()) {
+		char mac[3 * ETH_ALEN];
+		format_mac(mac, ss.peers[k].mac);
+
+		if (ss.latency) {
+			printf("peer %s: round trips %llu, rtt min %.3f us, p50 %.3f us, max %.3f us, lost %llu\n",
+					mac,
+					(unsigned long long) w[0].rtt->total(),
+					double(w[0].rtt->lowest()) * 1e-3,
+					double(w[0].rtt->percentile(50.0)) * 1e-3,
+					double(w[0].rtt->highest()) * 1e-3,
+					(unsigned long long) lost);
+		}
+		else if (ss.duplex) {
+			const uint64_t dt_tx = t1[0] - t0[0];
+			const uint64_t dt_rx = t1[1] - t0[1];
+
+			printf("peer %s: tx bandwidth %f bytes/s, rx bandwidth %f bytes/s, received %llu frames, lost %llu\n",
+					mac,
+					0 != dt_tx ? octets / (double(dt_tx) * 1e-9) : 0.0,
+					0 != dt_rx ? octets_rx / (double(dt_rx) * 1e-9) : 0.0,
+					(unsigned long long) total.received,
+					(unsigned long long) lost);
+		}
+		else {
+			const uint64_t dt = t1[0] - t0[0];
+			const double s = double(dt) * 1e-9;
+
+			printf("peer %s: elapsed time %f s, bandwidth %f bytes/s, goodput %f bytes/s, received %llu frames, lost %llu\n",
+					mac,
+					s,
+					0 != dt ? (octets + octets_rx) / s : 0.0,
+					0 != dt ? octets_rx * 2.0 / s : 0.0,
+					(unsigned long long) total.received,
+					(unsigned long long) lost);
+		}
+
+		return;
+	}
+
+	put_meta(out, "peer", ss, int(k));
+
+	if (ss.latency)
+		print_latency(out, *w[0].rtt, t1[0] - t0[0], 0);
+	else if (ss.duplex) {
+		print_figures(out, "tx ", "transmitted", t1[0] - t0[0], octets, frames);
+		print_figures(out, "rx ", "received", t1[1] - t0[1], octets_rx, frames_rx);
+		print_goodput(out, t1[1] - t0[1], octets_rx);
+	}
+	else {
+		print_figures(out, "", "transceived", t1[0] - t0[0], octets + octets_rx, frames + frames_rx);
+		print_goodput(out, t1[0] - t0[0], octets_rx * 2.0);
+	}
+
+	print_loss(out, total, ss.packet_count, ss.verify);
+	out.end();
+}
+
+// frame size of the handshake; a control frame is sized to fit its header and the offer, past ETH_ZLEN
+static const size_t control_frame_size = ETH_HLEN + sizeof(wire_header) + sizeof(wire_hello);
+
+enum session_mode {
+	session_mode_half_duplex,
+	session_mode_full_duplex,
+	session_mode_ping_pong
+};
+
+static uint8_t mode_of(
+	const session& ss) {
+
+	return ss.latency ? session_mode_ping_pong : ss.duplex ? session_mode_full_duplex : session_mode_half_duplex;
+}
+
+// transport engines: port of the first worker at this end of the session with the specified peer,
+// the workers of each peer in turn
+static uint16_t transport_port_of(
+	const session& ss,
+	const uint32_t k) { // index of the peer
+
+	return uint16_t(transport_port_base + k * ss.threads);
+}
+
+// fill in the session parameters of a control frame
+static void put_hello(
+	wire_hello& hello,
+	const session& ss,
+	const uint8_t kind) {
+
+	memset(&hello, 0, sizeof(hello));
+	hello.kind = kind;
+	hello.mode = mode_of(ss);
+	hello.engine = uint8_t(ss.engine);
+	hello.threads = uint8_t(ss.threads);
+	hello.packet_count = htobe32(ss.packet_count);
+	hello.size_min = htobe16(uint16_t(ss.size_min));
+	hello.size_max = htobe16(uint16_t(ss.size_max));
+	hello.size_step = htobe16(uint16_t(ss.size_step));
+	hello.rate_pps = htobe16(ss.rate_pps ? 1 : 0);
+	hello.rate = htobe64(uint64_t(ss.rate + 0.5));
+	hello.rx_timeout = htobe32(uint32_t(ss.rx_timeout));
+	hello.duration = htobe32(ss.duration);
+	hello.payload = uint8_t(ss.payload);
+	hello.verify = ss.verify ? 1 : 0;
+	hello.batch = htobe16(uint16_t(ss.batch));
+	hello.runs = htobe16(uint16_t(ss.runs));
+	hello.warmup_runs = uint8_t(ss.warmup_runs);
+	hello.more = ss.more ? 1 : 0;
+	hello.warmup_frames = htobe32(ss.warmup_frames);
+}
+
+// responder: check the parameters offered against those given on the command line, 0 meaning not
+// given, then adopt the offer; the batch is a matter of each end, the offer's going only if none given
+static bool take_hello(
+	const wire_hello& hello,
+	session& ss,
+	const bool mode_set,   // mode given on the command line
+	const bool engine_set) { // engine given on the command line
+
+	const uint32_t packet_count = be32toh(hello.packet_count);
+	const size_t size_min = be16toh(hello.size_min);
+	const size_t size_max = be16toh(hello.size_max);
+	const size_t size_step = be16toh(hello.size_step);
+	const double rate = double(be64toh(hello.rate));
+	const bool rate_pps = 0 != be16toh(hello.rate_pps);
+	const int rx_timeout = int(be32toh(hello.rx_timeout));
+	const uint32_t duration = be32toh(hello.duration);
+	const size_t batch = be16toh(hello.batch);
+	const uint32_t runs = be16toh(hello.runs);
+	const uint32_t warmup_frames = be32toh(hello.warmup_frames);
+
+	if ((mode_set && mode_of(ss) != hello.mode) ||
+		(0 != ss.threads && ss.threads != hello.threads) ||
+		(0 != ss.packet_count && ss.packet_count != packet_count) ||
+		(0 != ss.size_step && (ss.size_min != size_min || ss.size_max != size_max || ss.size_step != size_step)) ||
+		(0.0 != ss.rate && (uint64_t(ss.rate + 0.5) != uint64_t(rate) || ss.rate_pps != rate_pps)) ||
+		(0 != ss.rx_timeout && ss.rx_timeout != rx_timeout) ||
+		(0 != ss.duration && ss.duration != duration) ||
+		(0 <= ss.payload && ss.payload != hello.payload) ||
+		(ss.verify && 0 == hello.verify)) {
+
+		fprintf(stderr, "error: session parameters offered by the transmitter disagree with the command line\n");
+		return false;
+	}
+
+	if (session_mode_ping_pong < hello.mode || 0 == hello.threads || threads_max < hello.threads * ss.peer_count ||
+		(0 == packet_count && 0 == duration) || (0 != duration && session_mode_half_duplex != hello.mode) ||
+		frame_min_size > size_min || size_min > size_max || frame_max_size < size_max || 0 == size_step ||
+		0 >= rx_timeout || payload_mode_count <= hello.payload || 0 == batch || batch_max < batch ||
+		0 == runs || runs_max < runs || ((1 < runs + hello.warmup_runs || 0 != warmup_frames) && 0 != duration)) {
+
+		fprintf(stderr, "error: invalid session parameters offered by the transmitter\n");
+		return false;
+	}
+
+	if (!engine_set && engine_type_count > hello.engine)
+		ss.engine = hello.engine;
+
+	if (!engines_agree(ss.engine, hello.engine)) {
+		fprintf(stderr, "error: engine %s does not get along with the transmitter's engine %s\n",
+				engine_name[ss.engine],
+				engine_type_count > hello.engine ? engine_name[hello.engine] : "unknown");
+		return false;
+	}
+
+	ss.duplex = session_mode_full_duplex == hello.mode;
+	ss.latency = session_mode_ping_pong == hello.mode;
+	ss.pinned = ss.pinned || 1 < hello.threads * ss.peer_count;
+	ss.threads = hello.threads;
+	ss.packet_count = packet_count;
+	ss.size_min = size_min;
+	ss.size_max = size_max;
+	ss.size_step = size_step;
+	ss.rate = rate;
+	ss.rate_pps = rate_pps;
+	ss.rx_timeout = rx_timeout;
+	ss.duration = duration;
+	ss.payload = hello.payload;
+	ss.verify = 0 != hello.verify;
+	ss.batch = 0 != ss.batch ? ss.batch : batch;
+	ss.runs = runs;
+	ss.warmup_runs = hello.warmup_runs;
+	ss.warmup_frames = warmup_frames;
+	ss.more = 0 != hello.more;
+	return true;
+}
+
+// open a socket for the control frames, bound to the test iface, taking in test frames from the
+// specified peer or, if 0, from anyone; fill in the header of the outgoing control frame, tagged like
+// the test frames of the first priority class, if tagging, into the room ahead of it
+static int control_socket(
+	const session& ss,
+	const uint8_t* const peer_mac,
+	uint8_t* const frame_tx,
+	sockaddr_ll& saddr) {
+
+	const int fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+
+	if (0 > fd) {
+		fprintf(stderr, "error: cannot create socket\n");
+		return -1;
+	}
+
+	uint8_t mac[8] = { 0 };
+
+	if (0 != peer_mac)
+		memcpy(mac, peer_mac, ETH_ALEN);
+
+	if (!attach_filter(fd, peer_mac) ||
+		!init_ethhdr_and_saddr(fd, ss.iface_name, ss.iface_namelen, mac, *reinterpret_cast< ethhdr* >(frame_tx), saddr)) {
+		close(fd);
+		return -1;
+	}
+
+	if (ss.vlan)
+		vlan_insert(frame_tx, vlan_tci(ss.vlan_id, ss.pcp[0]));
+
+	if (0 > bind(fd, reinterpret_cast< sockaddr* >(&saddr), sizeof(saddr))) {
+		fprintf(stderr, "error: cannot bind to iface\n");
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+// transmitter: offer the session parameters, and the session id, to the specified peer until it
+// answers
+static bool offer(
+	session& ss,
+	const uint32_t k) { // index of the peer
+
+	peer& p = ss.peers[k];
+	uint8_t control_tx[vlan_tag_size + control_frame_size]; // room for a tag ahead of the frame
+	uint8_t* const frame_tx = control_tx + vlan_tag_size;
+	uint8_t frame_rx[control_frame_size];
+	sockaddr_ll saddr;
+	const scoped< int, close_file_descriptor > fd(control_socket(ss, p.mac, frame_tx, saddr));
+
+	if (0 > fd)
+		return false;
+
+	uint8_t* const payload_tx = frame_tx + ETH_HLEN;
+	const uint8_t* const payload_rx = frame_rx + ETH_HLEN;
+	wire_hello& hello_tx = *reinterpret_cast< wire_hello* >(payload_tx + sizeof(wire_header));
+	const wire_hello& hello_rx = *reinterpret_cast< const wire_hello* >(payload_rx + sizeof(wire_header));
+	char mac[3 * ETH_ALEN];
+	format_mac(mac, p.mac);
+
+	wire_init(payload_tx, control_frame_size, 0, p.session_id, wire_flag_control);
+	put_hello(hello_tx, ss, wire_hello_offer);
+	hello_tx.ipv4 = ss.ipv4;
+	hello_tx.port = htobe16(transport_port_of(ss, k));
+
+	if (!set_rx_timeout(fd, handshake_interval_ms))
+		return false;
+
+	// offer until answered, skipping anything but answers to this very session
+	for (uint32_t attempt = 0; attempt < handshake_attempts;) {
+		if (0 > sendto(fd, frame_tx - tag_size_of(ss), control_frame_size + tag_size_of(ss), 0, reinterpret_cast< const sockaddr* >(&saddr), sizeof(saddr))) {
+			fprintf(stderr, "error: sendto() failed (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		const ssize_t recv = recvfrom(fd, frame_rx, sizeof(frame_rx), MSG_TRUNC, 0, 0);
+
+		if (0 > recv) {
+			if (EAGAIN != errno && EWOULDBLOCK != errno && EINTR != errno) {
+				fprintf(stderr, "error: recvfrom() failed (errno: %s)\n", strerror(errno));
+				return false;
+			}
+
+			++attempt;
+			continue;
+		}
+
+		if (ssize_t(control_frame_size) != recv ||
+			!wire_valid(payload_rx, control_frame_size) ||
+			(wire_flag_control | wire_flag_response) != wire_flags_of(payload_rx) ||
+			p.session_id != wire_session_of(payload_rx))
+			continue;
+
+		if (wire_hello_reject == hello_rx.kind) {
+			fprintf(stderr, "error: responder %s rejected the session parameters\n", mac);
+			return false;
+		}
+
+		if (wire_hello_accept == hello_rx.kind) {
+			p.ipv4 = hello_rx.ipv4;
+			p.port = be16toh(hello_rx.port);
+			fprintf(ss.out->info(), "responder %s, engine %s\n", mac, engine_type_count > hello_rx.engine ? engine_name[hello_rx.engine] : "unknown");
+			return true;
+		}
+	}
+
+	fprintf(stderr, "error: no answer from responder %s\n", mac);
+	return false;
+}
+
+// responder: await an offer from each of the peers, from anyone unless the peers are known; learn
+// their mac addresses and session ids, and adopt the parameters of the first offer, which the others
+// have to agree with; answer them all at once, when all are in, for the transmitters to set off
+// together
+static bool await_offers(
+	session& ss,
+	const bool mode_set,     // mode given on the command line
+	const bool engine_set) { // engine given on the command line
+
+	uint8_t control_tx[vlan_tag_size + control_frame_size]; // room for a tag ahead of the frame
+	uint8_t* const frame_tx = control_tx + vlan_tag_size;
+	uint8_t frame_rx[control_frame_size];
+	sockaddr_ll saddr;
+	const scoped< int, close_file_descriptor > fd(control_socket(ss, ss.target_set && 1 == ss.peer_count ? ss.peers[0].mac : 0, frame_tx, saddr));
+
+	if (0 > fd)
+		return false;
+
+	uint8_t* const payload_tx = frame_tx + ETH_HLEN;
+	const uint8_t* const payload_rx = frame_rx + ETH_HLEN;
+	wire_hello& hello_tx = *reinterpret_cast< wire_hello* >(payload_tx + sizeof(wire_header));
+	const wire_hello& hello_rx = *reinterpret_cast< const wire_hello* >(payload_rx + sizeof(wire_header));
+	uint32_t offered = 0; // peers whose offers are in, the first ones of ss.peers
+	bool accept = true;
+
+	while (accept && offered < ss.peer_count) {
+		sockaddr_ll from;
+		socklen_t fromlen = sizeof(from);
+		const ssize_t recv = recvfrom(fd, frame_rx, sizeof(frame_rx), MSG_TRUNC, reinterpret_cast< sockaddr* >(&from), &fromlen);
+
+		if (0 > recv) {
+			if (EINTR == errno)
+				continue;
+
+			fprintf(stderr, "error: recvfrom() failed (errno: %s)\n", strerror(errno));
+			return false;
+		}
+
+		if (ssize_t(control_frame_size) != recv ||
+			!wire_valid(payload_rx, control_frame_size) ||
+			wire_flag_control != wire_flags_of(payload_rx) ||
+			wire_hello_offer != hello_rx.kind ||
+			ETH_ALEN != from.sll_halen)
+			continue;
+
+		// the peers known: those whose offers are in, and with the peers given, all of them
+		const uint32_t known = ss.target_set ? ss.peer_count : offered;
+		uint32_t k = 0;
+
+		while (k < known && 0 != memcmp(ss.peers[k].mac, from.sll_addr, ETH_ALEN))
+			++k;
+
+		// a peer repeating its offer, of a new session if it has started over
+		if (k < offered) {
+			ss.peers[k].session_id = wire_session_of(payload_rx);
+			ss.peers[k].ipv4 = hello_rx.ipv4;
+			ss.peers[k].port = be16toh(hello_rx.port);
+			continue;
+		}
+
+		// with the peers known, offers from others do not count; the peer goes next in line
+		if (ss.target_set) {
+			if (k == known)
+				continue;
+
+			const peer next = ss.peers[offered];
+			ss.peers[offered] = ss.peers[k];
+			ss.peers[k] = next;
+		}
+		else
+			memcpy(ss.peers[offered].mac, from.sll_addr, ETH_ALEN);
+
+		ss.peers[offered].session_id = wire_session_of(payload_rx);
+		ss.peers[offered].ipv4 = hello_rx.ipv4;
+		ss.peers[offered].port = be16toh(hello_rx.port);
+
+		char mac[3 * ETH_ALEN];
+		format_mac(mac, ss.peers[offered].mac);
+
+		fprintf(ss.out->info(), "transmitter %s, engine %s\n",
+				mac,
+				engine_type_count > hello_rx.engine ? engine_name[hello_rx.engine] : "unknown");
+
+		// past the first offer, the parameters taken are as good as given on the command line
+		accept = (0 == offered || ss.verify == (0 != hello_rx.verify)) &&
+			take_hello(hello_rx, ss, mode_set || 0 != offered, engine_set || 0 != offered);
+		++offered;
+	}
+
+	// address readback: answer, and from now on talk to, whoever sent the offers
+	for (uint32_t k = 0; k < offered; ++k) {
+		if (!init_ethhdr_and_saddr(fd, ss.iface_name, ss.iface_namelen, ss.peers[k].mac, *reinterpret_cast< ethhdr* >(frame_tx), saddr))
+			return false;
+
+		if (ss.vlan)
+			vlan_insert(frame_tx, vlan_tci(ss.vlan_id, ss.pcp[0]));
+
+		wire_init(payload_tx, control_frame_size, 0, ss.peers[k].session_id, wire_flag_control | wire_flag_response);
+		put_hello(hello_tx, ss, accept ? wire_hello_accept : wire_hello_reject);
+		hello_tx.ipv4 = ss.ipv4;
+		hello_tx.port = htobe16(transport_port_of(ss, k));
+
+		if (0 > sendto(fd, frame_tx - tag_size_of(ss), control_frame_size + tag_size_of(ss), 0, reinterpret_cast< const sockaddr* >(&saddr), sizeof(saddr))) {
+			fprintf(stderr, "error: sendto() failed (errno: %s)\n", strerror(errno));
+			return false;
+		}
+	}
+
+	return accept;
+}
+
+// control handshake ahead of the measurement: the transmitter offers the session parameters to
+// each of its peers in turn, the responder awaits the offers of all of its peers
+static bool handshake(
+	session& ss,
+	const bool mode_set,     // responder: mode given on the command line
+	const bool engine_set) { // responder: engine given on the command line
+
+	if (!ss.transmitter)
+		return await_offers(ss, mode_set, engine_set);
+
+	for (uint32_t k = 0; k < ss.peer_count; ++k) {
+		if (!offer(ss, k))
+			return false;
+	}
+
+	return true;
+}
+
+// run the test sequence, or stream, on all workers and print the figures; the transmitter gets the
+// headline figure of the run, see metric_of, 0 if none
+template < class ENGINE_T >
+static int run(
+	const session& ss,
+	double& figure) {
+
+	figure = 0.0;
+
+	// room for the histograms of each worker: round-trip times in latency mode, plus wire-side
+	// round-trip times or frame gaps when timestamping, or the two round-trip time buffers of the
+	// soak transmitter; the soak reporter adds two of its own
+	const bool timestamping = timestamp_none != ss.timestamp;
+	const bool soak = 0 != ss.duration;
+	const bool reporter = soak && ss.transmitter;
+	const uint32_t histogram_count = reporter ? 2 : (ss.latency ? 1 : 0) + (timestamping ? 1 : 0);
+	const uint32_t workers = workers_of(ss);
+	const uint32_t histogram_total = histogram_count * workers + (reporter ? 2 : 0);
+	const scoped< histogram*, generic_free > hist(
+		reinterpret_cast< histogram* >(histogram_total ? malloc(sizeof(histogram) * histogram_total) : 0));
+
+	if (histogram_total && 0 == hist) {
+		fprintf(stderr, "error: cannot allocate histograms\n");
+		return -1;
+	}
+
+	worker< ENGINE_T > w[threads_max];
+	const long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	const uint32_t lane_count = (ss.duplex && !ss.reflect) || reporter ? 2 : 1;
+
+	// the workers of each peer in turn, each worker testing with one peer, by an index local to the peer
+	for (uint32_t i = 0; i < workers; ++i) {
+		const uint32_t k = i / ss.threads;
+		const uint32_t local = i % ss.threads;
+		const peer& p = ss.peers[k];
+
+		for (uint32_t j = 0; j < lane_count; ++j) {
+			w[i].lanes[j].w = &w[i];
+			w[i].lanes[j].role = reporter ? (0 == j ? lane_soak_tx : lane_soak_rx) :
+				ss.reflect ? lane_reflect :
+				soak ? lane_soak_echo :
+				ss.duplex ? (0 == j ? lane_tx : lane_rx) : lane_half_duplex;
+			w[i].lanes[j].cpu = 0 != ss.cpu_count ? ss.cpus[(i * lane_count + j) % ss.cpu_count] :
+				ss.pinned && 0 < ncpus ? int((i * lane_count + j) % ncpus) : -1;
+		}
+
+		// frame memory on the node of the worker's first lane: the template and incoming frames,
+		// and the batches of the engines keeping frames of their own
+		if (!w[i].pool.init(2 + 2 * ss.batch, tag_size_of(ss) + ss.frame_size, ss.hugepages, cpu_node(w[i].lanes[0].cpu)))
+			return -1;
+
+		// frame0 - outgoing, frame1 - incoming; each with room for a tag ahead of it
+		uint8_t* const frame0 = w[i].pool.take(1) + tag_size_of(ss);
+		uint8_t* const frame1 = w[i].pool.take(1) + tag_size_of(ss);
+
+		// get an ethernet socket
+		w[i].fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+
+		if (0 > w[i].fd) {
+			fprintf(stderr, "error: cannot create socket\n");
+			return -1;
+		}
+
+		if (!attach_filter(w[i].fd, p.mac))
+			return -1;
+
+		if (!init_ethhdr_and_saddr(w[i].fd, ss.iface_name, ss.iface_namelen, p.mac, *reinterpret_cast< ethhdr* >(frame0), w[i].saddr)) {
+			return -1;
+		}
+
+		if (0 == i && !check_mtu(w[i].fd, ss.iface_name, ss.iface_namelen, ss.frame_size))
+			return -1;
+
+		if (0 == i && 1 < ss.threads && engine_type_xdp == ss.engine)
+			check_flow_steering(w[i].fd, ss.iface_name, ss.iface_namelen, ss.threads);
+
+		// the responder flags its frames as responses
+		const uint8_t wire_flags = ss.transmitter ? (ss.latency || soak ? wire_flag_timestamp : 0) : wire_flag_response;
+		wire_init(frame0 + ETH_HLEN, ss.frame_size, local, p.session_id, wire_flags);
+		w[i].body.init(ss.payload, ss.verify, ss.frame_size);
+		w[i].body.fill(frame0 + ETH_HLEN);
+
+		// the workers of a peer take the priority classes in turn
+		if (ss.vlan)
+			vlan_insert(frame0, vlan_tci(ss.vlan_id, pcp_of(ss, local)));
+
+		// bind socket to specified iface (for the receiving part)
+		if (0 > bind(w[i].fd, reinterpret_cast< sockaddr* >(&w[i].saddr), sizeof(w[i].saddr))) {
+			fprintf(stderr, "error: cannot bind to iface\n");
+			return -1;
+		}
+
+		if (!tune_socket(w[i].fd, ss))
+			return -1;
+
+		// only the pinging end fetches tx timestamps, which otherwise pile up on the error queue
+		const int timestamp = timestamping ?
+			enable_timestamping(w[i].fd, ss.iface_name, ss.iface_namelen, ss.timestamp, ss.latency && ss.transmitter) :
+			timestamp_none;
+
+		if (0 > timestamp)
+			return -1;
+
+		w[i].cfg.fd = w[i].fd;
+		w[i].cfg.saddr = &w[i].saddr;
+		w[i].cfg.frame_tx = frame0;
+		w[i].cfg.frame_rx = frame1;
+		w[i].cfg.pool = &w[i].pool;
+		w[i].cfg.frame_size = ss.frame_size;
+		w[i].cfg.batch = 0.0 < ss.rate ? 1 : ss.batch; // paced frames are kicked one at a time
+		w[i].cfg.queue = ss.queue + i;
+		w[i].cfg.timestamp = timestamp;
+		w[i].cfg.rx_timeout = ss.rx_timeout;
+		w[i].cfg.poll = ss.poll;
+		w[i].cfg.tag_size = tag_size_of(ss);
+		w[i].cfg.tci = ss.vlan ? vlan_tci(ss.vlan_id, pcp_of(ss, local)) : 0;
+		w[i].cfg.sqpoll = ss.sqpoll;
+		w[i].cfg.local_ip = ss.ipv4;
+		w[i].cfg.peer_ip = p.ipv4;
+		w[i].cfg.local_port = uint16_t(transport_port_of(ss, k) + local);
+		w[i].cfg.peer_port = uint16_t(p.port + local);
+		w[i].cfg.initiator = ss.transmitter;
+		w[i].cfg.sndbuf = ss.sndbuf;
+		w[i].cfg.rcvbuf = ss.rcvbuf;
+		w[i].cfg.priority = ss.priority;
+
+		if (!w[i].engine.init(w[i].cfg))
+			return -1;
+
+		w[i].sock.take(w[i].fd);
+
+		// engines may re-bind their socket, so join the fanout group only after engine setup; a group
+		// per peer, each group getting all incoming frames, the socket filters passing those of the peer
+		if (1 < ss.threads && !join_fanout(w[i].fd, uint16_t(getpid() + k)))
+			return -1;
+
+		w[i].ss = &ss;
+		w[i].index = i;
+		w[i].peer = k;
+		w[i].seq_begin = uint64_t(ss.packet_count) * local / ss.threads;
+		w[i].seq_end = uint64_t(ss.packet_count) * (local + 1) / ss.threads;
+		w[i].session_id = p.session_id;
+		w[i].lane_count = lane_count;
+
+		w[i].warm_begin = uint64_t(ss.warmup_frames) * local / ss.threads;
+		w[i].warm_end = uint64_t(ss.warmup_frames) * (local + 1) / ss.threads;
+
+		if (!w[i].tracker.init(w[i].seq_begin, w[i].seq_end) || !w[i].warm.init(w[i].warm_begin, w[i].warm_end))
+			return -1;
+
+		// each worker sends its share of the rate
+		if (0.0 < ss.rate) {
+			const double frame_rate = ss.rate_pps ? ss.rate : ss.rate / (double(ss.frame_size + tag_size_of(ss) + frame_wire_overhead) * 8.0);
+			w[i].interval = 1e9 * double(ss.threads) / frame_rate;
+		}
+
+		histogram* h = hist + histogram_count * i;
+
+		if (reporter) {
+			w[i].soak.h[0] = h++;
+			w[i].soak.h[1] = h++;
+			w[i].soak.h[0]->reset();
+			w[i].soak.h[1]->reset();
+		}
+
+		if (ss.latency) {
+			w[i].rtt = h++;
+			w[i].rtt->reset();
+		}
+
+		if (timestamping) {
+			histogram* const ts = h++;
+			ts->reset();
+
+			if (ss.latency)
+				w[i].wire = ts;
+			else
+				w[i].gap = ts;
+		}
+	}
+
+	// the socket options in effect, as set up alike on all sockets
+	fprintf(ss.out->info(), "socket sndbuf %d, rcvbuf %d, priority %d, qdisc bypass %s, tx loss %s\n",
+			w[0].sock.sndbuf,
+			w[0].sock.rcvbuf,
+			w[0].sock.priority,
+			1 == w[0].sock.qdisc_bypass ? "on" : "off",
+			1 == w[0].sock.tx_loss ? "on" : "off");
+
+	// system figures from right before the lanes set off
+	system_figures sys;
+	sys.irq_valid = ss.perf && sys.irq[0].take(ss.iface_name);
+	sys.softnet_valid = ss.perf && sys.softnet[0].take();
+
+	// the soak reporter sets off along with the lanes
+	pthread_barrier_t barrier;
+	pthread_barrier_init(&barrier, 0, workers * lane_count + (reporter ? 1 : 0));
+
+	// the lanes await the launch; the barrier cannot be passed short of the full count, so should a
+	// lane not be created, those that are go back without running, and the run fails
+	int launch = 0;
+	uint32_t created = 0;
+
+	for (uint32_t i = 0; i < workers && i * lane_count == created; ++i) {
+		w[i].barrier = &barrier;
+		w[i].launch = &launch;
+
+		for (uint32_t j = 0; j < lane_count; ++j, ++created) {
+			const int err = pthread_create(&w[i].lanes[j].thread, 0, lane_main< ENGINE_T >, &w[i].lanes[j]);
+
+			if (0 != err) {
+				fprintf(stderr, "error: cannot create thread (errno: %s)\n", strerror(err));
+				break;
+			}
+		}
+	}
+
+	const bool launched = workers * lane_count == created;
+	__atomic_store_n(&launch, launched ? 1 : -1, __ATOMIC_RELEASE);
+
+	histogram* const soak_total = hist + histogram_count * workers;
+
+	if (reporter && launched)
+		soak_report(w, ss, barrier, soak_total[1], soak_total[0]);
+
+	bool ok = launched;
+
+	for (uint32_t k = 0; k < created; ++k) {
+		typename worker< ENGINE_T >::lane& l = w[k / lane_count].lanes[k % lane_count];
+
+		pthread_join(l.thread, 0);
+		ok = ok && l.ok;
+	}
+
+	pthread_barrier_destroy(&barrier);
+
+	sys.irq_valid = sys.irq_valid && sys.irq[1].take(ss.iface_name);
+	sys.softnet_valid = sys.softnet_valid && sys.softnet[1].take();
+
+	if (!ok)
+		return -1;
+
+	// frames moved either way: the shares sent, and the frames received; a reflector sends what it
+	// receives
+	uint64_t frames_moved = ss.reflect ? 0 : uint64_t(ss.packet_count) * ss.peer_count;
+	uint64_t reflected = 0;
+
+	for (uint32_t i = 0; i < workers; ++i) {
+		frames_moved += w[i].tracker.received + w[i].window.received;
+		reflected += ss.reflect ? w[i].window.received : 0;
+	}
+
+	frames_moved += reflected;
+
+	// the responder has no figures of its own to print here, but those of the system and of its
+	// engine calls, the count of corrupt frames and, reflecting, that of the frames reflected
+	if (!ss.transmitter && (!ss.duplex || soak || ss.reflect)) {
+		const bool probes = 0 != BANDW_INSTRUMENT;
+		const bool placed = 0 != ss.cpu_count || 0 != ss.rt_priority || 0 != ss.irqs;
+		const bool record = ss.perf || probes || ss.verify || ss.reflect || placed;
+
+		if (record) {
+			put_meta(*ss.out, "run", ss, -1);
+			put_socket(*ss.out, w[0].sock);
+		}
+
+		if (placed)
+			print_placement(*ss.out, ss, w, workers, lane_count);
+
+		if (ss.reflect) {
+			if (ss.out->text())
+				printf("reflected %llu frames\n", (unsigned long long) reflected);
+			else
+				ss.out->u64("reflected", reflected);
+		}
+
+		if (ss.verify) {
+			uint64_t corrupt = 0;
+
+			for (uint32_t i = 0; i < workers; ++i)
+				corrupt += w[i].tracker.corrupt + w[i].window.corrupt;
+
+			if (ss.out->text())
+				printf("received corrupt %llu frames\n", (unsigned long long) corrupt);
+			else
+				ss.out->u64("corrupt", corrupt);
+		}
+
+		if (ss.perf)
+			print_system(*ss.out, ss, w, lane_count, sys, frames_moved);
+
+#if BANDW_INSTRUMENT
+		print_probes(*ss.out, w, workers, lane_count);
+
+#endif
+		if (record)
+			ss.out->end();
+
+		return 0;
+	}
+
+	if (reporter) {
+		print_soak(w, ss, soak_total[0], sys);
+		return 0;
+	}
+
+	// per-thread figures, then the totals over the span of all threads, per lane
+	report& out = *ss.out;
+	uint64_t t0[2] = { w[0].lanes[0].t0, w[0].lanes[1].t0 };
+	uint64_t t1[2] = { w[0].lanes[0].t1, w[0].lanes[1].t1 };
+	seq_tracker total;
+
+	for (uint32_t i = 0; i < workers; ++i) {
+		total.add(w[i].tracker);
+
+		for (uint32_t j = 0; j < lane_count; ++j) {
+			t0[j] = t0[j] < w[i].lanes[j].t0 ? t0[j] : w[i].lanes[j].t0;
+			t1[j] = t1[j] > w[i].lanes[j].t1 ? t1[j] : w[i].lanes[j].t1;
+		}
+
+		if (1 == ss.threads)
+			continue;
+
+		const double octets = double(ss.frame_size - ETH_HLEN) * double(w[i].seq_end - w[i].seq_begin);
+		const double octets_rx = double(ss.frame_size - ETH_HLEN) * double(w[i].tracker.received);
+		const uint32_t pcp = pcp_of(ss, i % ss.threads);
+
+		// the priority class of the thread, if tagging
+		char cls[16] = "";
+
+		if (ss.vlan)
+			snprintf(cls, sizeof(cls), ", pcp %u", pcp);
+
+		if (!out.text()) {
+			put_meta(out, "thread", ss, int(w[i].peer));
+			out.u64("thread", i);
+			out.i64("pcp", ss.vlan ? int64_t(pcp) : -1);
+
+			if (ss.duplex) {
+				out.i64("tx_cpu", w[i].lanes[0].cpu);
+				out.i64("rx_cpu", w[i].lanes[1].cpu);
+				print_figures(out, "tx ", "transmitted", w[i].lanes[0].t1 - w[i].lanes[0].t0, octets, double(w[i].seq_end - w[i].seq_begin));
+				print_figures(out, "rx ", "received", w[i].lanes[1].t1 - w[i].lanes[1].t0, octets_rx, double(w[i].tracker.received));
+			}
+			else {
+				out.i64("cpu", w[i].lanes[0].cpu);
+
+				if (ss.latency)
+					print_latency(out, *w[i].rtt, w[i].lanes[0].t1 - w[i].lanes[0].t0, 0);
+				else
+					print_figures(out, "", "transceived", w[i].lanes[0].t1 - w[i].lanes[0].t0, octets + octets_rx,
+						double(w[i].seq_end - w[i].seq_begin + w[i].tracker.received));
+			}
+
+			print_loss(out, w[i].tracker, w[i].seq_end - w[i].seq_begin, ss.verify);
+			out.end();
+		}
+		else if (ss.duplex) {
+			const uint64_t dt_tx = w[i].lanes[0].t1 - w[i].lanes[0].t0;
+			const uint64_t dt_rx = w[i].lanes[1].t1 - w[i].lanes[1].t0;
+
+			printf("thread %u, cpu %d/%d%s: tx elapsed time %f s, bandwidth %f bytes/s; rx elapsed time %f s, bandwidth %f bytes/s\n",
+					i,
+					w[i].lanes[0].cpu,
+					w[i].lanes[1].cpu,
+					cls,
+					double(dt_tx) * 1e-9,
+					0 != dt_tx ? octets / (double(dt_tx) * 1e-9) : 0.0,
+					double(dt_rx) * 1e-9,
+					0 != dt_rx ? octets_rx / (double(dt_rx) * 1e-9) : 0.0);
+		}
+		else if (ss.latency) {
+			printf("thread %u, cpu %d%s: round trips %llu, rtt min %.3f us, p50 %.3f us, max %.3f us\n",
+					i,
+					w[i].lanes[0].cpu,
+					cls,
+					(unsigned long long) w[i].rtt->total(),
+					double(w[i].rtt->lowest()) * 1e-3,
+					double(w[i].rtt->percentile(50.0)) * 1e-3,
+					double(w[i].rtt->highest()) * 1e-3);
+		}
+		else {
+			const uint64_t dt = w[i].lanes[0].t1 - w[i].lanes[0].t0;
+			const double transcieved = octets + octets_rx;
+			const double s = double(dt) * 1e-9;
+
+			printf("thread %u, cpu %d%s: elapsed time %f s, transceived %.0f bytes, bandwidth %f bytes/s\n",
+					i,
+					w[i].lanes[0].cpu,
+					cls,
+					s,
+					transcieved,
+					0 != dt ? transcieved / s : 0.0);
+		}
+	}
+
+	const double frames = double(ss.packet_count) * double(ss.peer_count);
+	const double octets = double(ss.frame_size - ETH_HLEN) * frames;
+	const double frames_rx = double(total.received);
+	const double octets_rx = double(ss.frame_size - ETH_HLEN) * frames_rx;
+
+	// the histograms add up per peer, in the first worker of each, then over all peers, in the
+	// first worker of all; the figures of each peer go ahead of the totals
+	for (uint32_t k = 0; k < ss.peer_count; ++k) {
+		worker< ENGINE_T >* const p = w + k * ss.threads;
+
+		for (uint32_t i = 1; i < ss.threads; ++i)
+			add_histograms(p[0], p[i]);
+
+		if (1 < ss.peer_count)
+			print_peer(out, ss, p, k);
+	}
+
+	for (uint32_t k = 1; k < ss.peer_count; ++k)
+		add_histograms(w[0], w[k * ss.threads]);
+
+	put_meta(out, "run", ss, -1);
+	put_socket(out, w[0].sock);
+	print_placement(out, ss, w, workers, lane_count);
+
+	if (ss.latency) {
+		if (!print_latency(out, *w[0].rtt, t1[0] - t0[0], ss.histogram_path))
+			return -1;
+
+		figure = double(w[0].rtt->percentile(50.0)) * 1e-3;
+
+		// the part of the round trip not spent on the wire and in the peer goes to host overhead
+		if (0 != w[0].wire) {
+			print_wire(out, "wire rtt", *w[0].wire);
+
+			if (0 != w[0].wire->total()) {
+				const double overhead = (double(w[0].rtt->percentile(50.0)) - double(w[0].wire->percentile(50.0))) * 1e-3;
+
+				if (out.text())
+					printf("host overhead p50 %.3f us\n", overhead);
+				else
+					out.f64("host_overhead_p50_us", overhead);
+			}
+		}
+	}
+	else if (ss.duplex) {
+		print_figures(out, "tx ", "transmitted", t1[0] - t0[0], octets, frames);
+		print_figures(out, "rx ", "received", t1[1] - t0[1], octets_rx, frames_rx);
+		print_goodput(out, t1[1] - t0[1], octets_rx);
+		figure = t1[1] != t0[1] ? octets_rx / (double(t1[1] - t0[1]) * 1e-9) : 0.0;
+	}
+	else {
+		// goodput counts the frames that made it there and back, both ways
+		print_figures(out, "", "transceived", t1[0] - t0[0], octets + octets_rx, frames + frames_rx);
+		print_goodput(out, t1[0] - t0[0], octets_rx * 2.0);
+		figure = t1[0] != t0[0] ? (octets + octets_rx) / (double(t1[0] - t0[0]) * 1e-9) : 0.0;
+	}
+
+	print_loss(out, total, uint64_t(ss.packet_count) * ss.peer_count, ss.verify);
+
+	if (0 != w[0].gap)
+		print_wire(out, "ifg", *w[0].gap);
+
+	if (ss.perf)
+		print_system(out, ss, w, lane_count, sys, frames_moved);
+
+#if BANDW_INSTRUMENT
+	print_probes(out, w, workers, lane_count);
+
+#endif
+	out.end();
+	return 0;
+}
+
+// lock the pages of the process in memory, keeping page faults out of the timed region; those mapped
+// later on, too, unless short of the privilege to exceed the memory lock limit, which the frame
+// memory and rings to come would run into
+static void lock_memory() {
+	rlimit lim;
+	const bool future = 0 == geteuid() || (0 == getrlimit(RLIMIT_MEMLOCK, &lim) && RLIM_INFINITY == lim.rlim_cur);
+
+	if (0 > mlockall(MCL_CURRENT | (future ? MCL_FUTURE : 0)))
+		fprintf(stderr, "warning: cannot lock the process memory (errno: %s)\n", strerror(errno));
+	else if (!future)
+		fprintf(stderr, "warning: memory lock limit in place, the pages mapped from now on are not locked\n");
+}
+
+// print the session parameters settled in the handshake
+static void announce(
+	const session& ss) {
+
+	report& out = *ss.out;
+	char fan[32] = "";
+
+	if (1 < ss.peer_count)
+		snprintf(fan, sizeof(fan), " per peer, peers %u", ss.peer_count);
+
+	fprintf(out.info(), "%s at interface %s, engine %s, batch %zu, threads %u%s, %s%s, timestamps %s, poll %s, payload %s%s, ",
+			ss.transmitter ? "transmitter" : "responder",
+			ss.iface_name,
+			engine_name[ss.engine],
+			ss.batch,
+			ss.threads,
+			fan,
+			ss.latency ? "ping-pong" : ss.duplex ? "full-duplex" : "half-duplex",
+			ss.reflect ? " reflected" : "",
+			timestamp_name[ss.timestamp],
+			rx_poll_name[ss.poll],
+			payload_name[ss.payload],
+			!ss.verify ? "" : crc32c::hardware() ? " verified by crc32c (hw)" : " verified by crc32c (sw)");
+
+	if (ss.size_min != ss.size_max)
+		fprintf(out.info(), "frame sizes %zu..%zu step %zu", ss.size_min, ss.size_max, ss.size_step);
+	else
+		fprintf(out.info(), "frame size %zu", ss.size_min);
+
+	if (0.0 < ss.rate)
+		fprintf(out.info(), ", rate %.0f %s", ss.rate, ss.rate_pps ? "frames/s" : "bits/s");
+
+	if (0 != ss.warmup_frames)
+		fprintf(out.info(), ", warm-up %u frames", ss.warmup_frames);
+
+	if (ss.vlan) {
+		fprintf(out.info(), ", vlan %u, pcp ", ss.vlan_id);
+
+		for (uint32_t i = 0; i < ss.pcp_count; ++i)
+			fprintf(out.info(), "%s%u", 0 == i ? "" : ",", ss.pcp[i]);
+	}
+
+	if (0 != ss.duration && ss.transmitter)
+		fprintf(out.info(), ", soak %u s, interval %.3f s\n", ss.duration, ss.report_interval);
+	else if (0 != ss.duration)
+		fprintf(out.info(), ", soak %u s\n", ss.duration);
+	else
+		fprintf(out.info(), "\n");
+}
+
+// the setup of the session at the current frame size, as a suite cell
+static void cell_of(
+	const session& ss,
+	suite_cell& c) { // output: the cell, but its figure
+
+	memset(&c, 0, sizeof(c));
+	snprintf(c.engine, sizeof(c.engine), "%s", engine_name[ss.engine]);
+	c.frame_size = uint32_t(ss.frame_size);
+	c.batch = uint32_t(ss.batch);
+	c.threads = ss.threads;
+	snprintf(c.mode, sizeof(c.mode), "%s", mode_name(ss));
+	snprintf(c.metric, sizeof(c.metric), "%s", metric_of(ss, c.higher_better));
+}
+
+// print the summary of the runs of a frame size; in suite mode, that of a cell, held against its
+// baseline cell, if any
+static void print_summary(
+	report& out,
+	const char* const kind,         // record kind, cstr
+	const session& ss,
+	const suite_cell& c,
+	const suite_cell* const base) { // baseline cell, 0 if none
+
+	const sample_summary& s = c.figure;
+	const int verdict = 0 != base ? suite_judge(c, *base) : suite_unchanged;
+	const double change = 0 != base && 0.0 != base->figure.median ? (s.median / base->figure.median - 1.0) * 100.0 : 0.0;
+
+	if (out.text()) {
+		printf("%s %s, frame size %u, batch %u, threads %u: %s median %f, ci %f..%f (%.1f%%), runs %u, min %f, max %f, mean %f, stddev %f",
+				kind,
+				c.engine,
+				c.frame_size,
+				c.batch,
+				c.threads,
+				c.metric,
+				s.median,
+				s.lo,
+				s.hi,
+				s.confidence * 100.0,
+				s.n,
+				s.min,
+				s.max,
+				s.mean,
+				s.stddev);
+
+		if (0 != base)
+			printf("; baseline %f, change %+.1f%%, %s", base->figure.median, change, suite_verdict_name(verdict));
+
+		printf("\n");
+		return;
+	}
+
+	put_meta(out, kind, ss, -1);
+	out.str("metric", c.metric);
+	out.f64("median", s.median);
+	out.f64("ci_lo", s.lo);
+	out.f64("ci_hi", s.hi);
+	out.f64("confidence", s.confidence);
+	out.u64("runs", s.n);
+	out.f64("min", s.min);
+	out.f64("max", s.max);
+	out.f64("mean", s.mean);
+	out.f64("stddev", s.stddev);
+
+	if (0 != base) {
+		out.f64("baseline_median", base->figure.median);
+		out.f64("change_pct", change);
+		out.str("verdict", suite_verdict_name(verdict));
+	}
+
+	out.end();
+}
+
+// all runs of the session: per frame size, the warm-up runs, then those counted; the transmitter
+// summarizes the headline figures of those counted, if more than one or in suite mode; both ends
+// step through the same sizes and runs, the responder setting up for each run while the transmitter
+// pauses
+static int measure(
+	session& ss,
+	suite_cell* const cell) { // suite mode: output: the summary of the cell, a single frame size; 0 otherwise
+
+	for (size_t size = ss.size_min; size <= ss.size_max; size += ss.size_step) {
+		ss.frame_size = size;
+
+		if (ss.size_min != ss.size_max)
+			fprintf(ss.out->info(), "frame size %zu\n", size);
+
+		double figure[runs_max];
+
+		for (uint32_t r = 0; r < ss.warmup_runs + ss.runs; ++r) {
+			if (ss.transmitter)
+				usleep(setup_pause_ms * 1000);
+
+			if (r < ss.warmup_runs)
+				fprintf(ss.out->info(), "warm-up run %u of %u\n", r + 1, ss.warmup_runs);
+			else if (1 < ss.runs)
+				fprintf(ss.out->info(), "run %u of %u\n", r - ss.warmup_runs + 1, ss.runs);
+
+			int res = 0;
+			double f = 0.0;
+
+			switch (ss.engine) {
+			case engine_type_socket:
+				res = run< probed< engine_socket >::type >(ss, f);
+				break;
+			case engine_type_ring:
+				res = run< probed< engine_ring >::type >(ss, f);
+				break;
+			case engine_type_mmsg:
+				res = run< probed< engine_mmsg >::type >(ss, f);
+				break;
+			case engine_type_xdp:
+				res = run< probed< engine_xdp >::type >(ss, f);
+				break;
+			case engine_type_uring:
+				res = run< probed< engine_uring >::type >(ss, f);
+				break;
+			case engine_type_udp:
+				res = run< probed< engine_udp >::type >(ss, f);
+				break;
+			case engine_type_tcp:
+				res = run< probed< engine_tcp >::type >(ss, f);
+				break;
+			}
+
+			if (0 != res)
+				return res;
+
+			if (ss.warmup_runs <= r)
+				figure[r - ss.warmup_runs] = f;
+		}
+
+		if (!ss.transmitter || (1 == ss.runs && 0 == cell))
+			continue;
+
+		suite_cell c;
+		cell_of(ss, c);
+		summarize(figure, ss.runs, c.figure);
+
+		if (0 != cell)
+			*cell = c;
+		else
+			print_summary(*ss.out, "summary", ss, c, 0);
+	}
+
+	return 0;
+}
+
+// transmitter, suite mode: a session per cell of the matrix, the frame size, batch and thread count
+// of the cell in place of those given; the socket engine takes no batch, and gets but the first one.
+// Print each cell as its runs are summarized, against the baseline if given, and save the cells if
+// so requested; 1 if any cell regressed
+static int run_suite(
+	session& ss,
+	const suite_matrix& m,
+	const char* const baseline_path, // baseline file to hold the cells against, cstr, 0 if none
+	const char* const save_path) {   // file to save the cells to as a baseline, cstr, 0 if none
+
+	// the baseline cells, as many as the suite may have, are too many for the stack
+	const scoped< suite_cell*, generic_free > base_cell(
+		reinterpret_cast< suite_cell* >(0 != baseline_path ? malloc(sizeof(suite_cell) * suite_cells_max) : 0));
+
+	if (0 != baseline_path && 0 == base_cell) {
+		fprintf(stderr, "error: cannot allocate baseline cells\n");
+		return -1;
+	}
+
+	suite_baseline baseline(base_cell);
+
+	if (0 != baseline_path) {
+		if (!baseline.load(baseline_path))
+			return -1;
+
+		fprintf(ss.out->info(), "baseline %s, kernel %s\n", baseline_path, '\0' != baseline.kernel[0] ? baseline.kernel : "unknown");
+	}
+
+	const suite_axis& engines = m.axis[suite_engines];
+	const suite_axis& sizes = m.axis[suite_sizes];
+	const suite_axis& batches = m.axis[suite_batches];
+	const suite_axis& threads = m.axis[suite_threads];
+	const scoped< suite_cell*, generic_free > cell(reinterpret_cast< suite_cell* >(malloc(sizeof(suite_cell) * suite_cells_max)));
+
+	if (0 == cell) {
+		fprintf(stderr, "error: cannot allocate suite cells\n");
+		return -1;
+	}
+
+	// lay out the cells, engine by engine, size by size, batch by batch
+	uint32_t count = 0;
+
+	for (uint32_t e = 0; e < engines.count; ++e) {
+		for (uint32_t z = 0; z < sizes.count; ++z) {
+			for (uint32_t b = 0; b < batches.count && (0 == b || engine_type_socket != engines.v[e]); ++b) {
+				for (uint32_t t = 0; t < threads.count; ++t) {
+					suite_cell& c = cell[count++];
+
+					memset(&c, 0, sizeof(c));
+					snprintf(c.engine, sizeof(c.engine), "%s", engine_name[engines.v[e]]);
+					c.frame_size = sizes.v[z];
+					c.batch = batches.v[b];
+					c.threads = threads.v[t];
+				}
+			}
+		}
+	}
+
+	const session initial = ss;
+	const uint32_t session_id = ss.peers[0].session_id;
+	uint32_t regressions = 0;
+	uint32_t improvements = 0;
+
+	for (uint32_t i = 0; i < count; ++i) {
+		ss = initial;
+
+		uint32_t e = 0;
+
+		while (strcmp(engine_name[e], cell[i].engine))
+			++e;
+
+		ss.engine = e;
+		ss.size_min = cell[i].frame_size;
+		ss.size_max = cell[i].frame_size;
+		ss.size_step = 1;
+		ss.batch = cell[i].batch;
+		ss.threads = cell[i].threads;
+		ss.warmup_runs = suite_warmup_runs;
+		ss.more = i + 1 < count;
+
+		// a session of its own per cell, with ids of its own
+		for (uint32_t k = 0; k < ss.peer_count; ++k)
+			ss.peers[k].session_id = session_id + 2 * (i * ss.peer_count + k);
+
+		fprintf(ss.out->info(), "suite cell %u of %u\n", i + 1, count);
+
+		if (!handshake(ss, false, false))
+			return -1;
+
+		announce(ss);
+
+		const int res = measure(ss, cell + i);
+
+		if (0 != res)
+			return res;
+
+		const suite_cell* const base = baseline.find(cell[i]);
+		const int verdict = 0 != base ? suite_judge(cell[i], *base) : suite_unchanged;
+
+		regressions += suite_regressed == verdict ? 1 : 0;
+		improvements += suite_improved == verdict ? 1 : 0;
+		print_summary(*ss.out, "cell", ss, cell[i], base);
+	}
+
+	if (0 != save_path && !suite_save(save_path, cell, count))
+		return -1;
+
+	fprintf(ss.out->info(), "suite: %u cells, %u regressions, %u improvements\n", count, regressions, improvements);
+	return 0 != regressions ? 1 : 0;
+}
+
+int main(
+	int argc,
+	char** argv) {
+
+	uint32_t iface_nameidx    = 0;
+	uint32_t iface_namelen    = 0;
+	uint8_t target[peers_max][8] = { { 0 } };
+	uint32_t target_count     = 0;
+	uint32_t peers            = 0;
+	uint32_t packet_count     = 0;
+	uint32_t engine           = engine_type_socket;
+	uint32_t batch            = 0;
+	uint32_t queue            = 0;
+	uint32_t threads          = 0;
+	uint32_t histogram_pathidx = 0;
+	uint32_t timestamp        = timestamp_none;
+	size_t size_min           = 0;
+	size_t size_max           = 0;
+	size_t size_step          = 0;
+	double rate               = 0.0;
+	bool rate_pps             = false;
+	uint32_t rx_timeout       = 0;
+	uint32_t duration         = 0;
+	double report_interval    = 0.0;
+	uint32_t format           = report_text;
+	uint32_t poll             = rx_poll_block;
+	uint32_t sndbuf           = 0;
+	uint32_t rcvbuf           = 0;
+	uint32_t priority         = 0;
+	uint32_t payload          = payload_inc;
+	uint32_t vlan_id          = 0;
+	uint8_t pcp[pcp_max]      = { 0 };
+	uint32_t pcp_count        = 0;
+	uint32_t runs             = 0;
+	uint32_t warmup_frames    = 0;
+	int cpus[cpu_list_max]    = { 0 };
+	uint32_t cpu_count        = 0;
+	uint32_t rt_priority      = 0;
+	uint32_t irq_cpu          = 0;
+	suite_matrix matrix;
+	uint32_t baseline_idx     = 0;
+	uint32_t save_idx         = 0;
+	uint32_t flags            = 0;
+	enum {
+		flag_transmitter = 1,
+		flag_target      = 2,
+		flag_engine      = 4,
+		flag_queue       = 8,
+		flag_duplex      = 16,
+		flag_latency     = 32,
+		flag_format      = 64,
+		flag_perf        = 128,
+		flag_poll        = 256,
+		flag_priority    = 512,
+		flag_qdisc_bypass = 1024,
+		flag_tx_loss     = 2048,
+		flag_hugepages   = 4096,
+		flag_payload     = 8192,
+		flag_verify      = 16384,
+		flag_reflect     = 32768,
+		flag_vlan        = 65536,
+		flag_suite       = 131072,
+		flag_irq         = 262144,
+		flag_sqpoll      = 524288
+	};
+
+	// get command line arguments
+	bool cmd_err = false;
+
+	for (uint32_t i = 1; i < argc && !cmd_err; ++i) {
+		cmd_err = true;
+
+		if (!strcmp(argv[i], argInterface)) {
+			if (++i < argc && !iface_nameidx) {
+				iface_namelen = strlen(argv[i]);
+
+				if (IFNAMSIZ > iface_namelen) {
+					iface_nameidx = i;
+					cmd_err = false;
+				}
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argTarget)) {
+			if (++i < argc && !(flags & flag_target)) {
+				if (parse_targets(argv[i], target, target_count)) {
+					flags |= flag_target;
+					cmd_err = false;
+				}
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argPeers)) {
+			if (++i < argc && !peers) {
+				if (1 == sscanf(argv[i], "%u", &peers) && 0 < peers && peers_max >= peers)
+					cmd_err = false;
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argPacketCount)) {
+			if (++i < argc && !packet_count) {
+				uint32_t count = 0;
+
+				if (1 == sscanf(argv[i], "%u", &count) && count) {
+					packet_count = count;
+					cmd_err = false;
+				}
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argEngine)) {
+			if (++i < argc && !(flags & flag_engine)) {
+				for (uint32_t j = 0; j < engine_type_count; ++j) {
+					if (!strcmp(argv[i], engine_name[j])) {
+						engine = j;
+						flags |= flag_engine;
+						cmd_err = false;
+						break;
+					}
+				}
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argBatch)) {
+			if (++i < argc && !batch) {
+				uint32_t count = 0;
+
+				if (1 == sscanf(argv[i], "%u", &count) && count && batch_max >= count) {
+					batch = count;
+					cmd_err = false;
+				}
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argQueue)) {
+			if (++i < argc && !(flags & flag_queue)) {
+				if (1 == sscanf(argv[i], "%u", &queue)) {
+					flags |= flag_queue;
+					cmd_err = false;
+				}
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argThreads)) {
+			if (++i < argc && !threads) {
+				uint32_t count = 0;
+
+				if (1 == sscanf(argv[i], "%u", &count) && count && threads_max >= count) {
+					threads = count;
+					cmd_err = false;
+				}
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argDuplex)) {
+			flags |= flag_duplex;
+			cmd_err = false;
+			continue;
+		}
+
+		if (!strcmp(argv[i], argLatency)) {
+			flags |= flag_latency;
+			cmd_err = false;
+			continue;
+		}
+
+		if (!strcmp(argv[i], argHistogram)) {
+			if (++i < argc && !histogram_pathidx) {
+				histogram_pathidx = i;
+				cmd_err = false;
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argTimestamp)) {
+			if (++i < argc && timestamp_none == timestamp) {
+				for (uint32_t j = timestamp_sw; j <= timestamp_hw; ++j) {
+					if (!strcmp(argv[i], timestamp_name[j])) {
+						timestamp = j;
+						cmd_err = false;
+						break;
+					}
+				}
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argSize)) {
+			if (++i < argc && !size_step) {
+				size_t size = 0;
+
+				if (1 == sscanf(argv[i], "%zu", &size) && frame_min_size <= size && frame_max_size >= size) {
+					size_min = size;
+					size_max = size;
+					size_step = 1;
+					cmd_err = false;
+				}
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argSweep)) {
+			if (++i < argc && !size_step) {
+				size_t lo = 0, hi = 0, step = 0;
+
+				if (3 == sscanf(argv[i], "%zu:%zu:%zu", &lo, &hi, &step) &&
+					frame_min_size <= lo && lo <= hi && frame_max_size >= hi && step) {
+
+					size_min = lo;
+					size_max = hi;
+					size_step = step;
+					cmd_err = false;
+				}
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argRate)) {
+			if (++i < argc && 0.0 == rate && parse_rate(argv[i], rate, rate_pps))
+				cmd_err = false;
+			continue;
+		}
+
+		if (!strcmp(argv[i], argTimeout)) {
+			if (++i < argc && !rx_timeout) {
+				uint32_t ms = 0;
+
+				if (1 == sscanf(argv[i], "%u", &ms) && ms && INT_MAX >= ms) {
+					rx_timeout = ms;
+					cmd_err = false;
+				}
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argDuration)) {
+			if (++i < argc && !duration) {
+				uint32_t sec = 0;
+
+				if (1 == sscanf(argv[i], "%u", &sec) && sec) {
+					duration = sec;
+					cmd_err = false;
+				}
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argInterval)) {
+			if (++i < argc && 0.0 == report_interval) {
+				double sec = 0.0;
+
+				if (1 == sscanf(argv[i], "%lf", &sec) && 1e-3 <= sec) {
+					report_interval = sec;
+					cmd_err = false;
+				}
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argFormat)) {
+			if (++i < argc && !(flags & flag_format)) {
+				for (uint32_t j = 0; j < report_format_count; ++j) {
+					if (!strcmp(argv[i], report_format_name[j])) {
+						format = j;
+						flags |= flag_format;
+						cmd_err = false;
+						break;
+					}
+				}
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argPoll)) {
+			if (++i < argc && !(flags & flag_poll)) {
+				for (uint32_t j = 0; j < rx_poll_mode_count; ++j) {
+					if (!strcmp(argv[i], rx_poll_name[j])) {
+						poll = j;
+						flags |= flag_poll;
+						cmd_err = false;
+						break;
+					}
+				}
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argSndbuf) || !strcmp(argv[i], argRcvbuf)) {
+			uint32_t& size = !strcmp(argv[i], argSndbuf) ? sndbuf : rcvbuf;
+
+			if (++i < argc && !size) {
+				uint32_t octets = 0;
+
+				// the kernel doubles the size asked for, which has to fit an int all the same
+				if (1 == sscanf(argv[i], "%u", &octets) && octets && INT_MAX / 2 >= octets) {
+					size = octets;
+					cmd_err = false;
+				}
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argPriority)) {
+			if (++i < argc && !(flags & flag_priority)) {
+				if (1 == sscanf(argv[i], "%u", &priority) && INT_MAX >= priority) {
+					flags |= flag_priority;
+					cmd_err = false;
+				}
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argVlan)) {
+			if (++i < argc && !(flags & flag_vlan)) {
+				if (parse_vlan(argv[i], vlan_id, pcp, pcp_count)) {
+					flags |= flag_vlan;
+					cmd_err = false;
+				}
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argRuns)) {
+			if (++i < argc && !runs) {
+				uint32_t count = 0;
+
+				if (1 == sscanf(argv[i], "%u", &count) && count && runs_max >= count) {
+					runs = count;
+					cmd_err = false;
+				}
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argCpu)) {
+			if (++i < argc && !cpu_count && parse_cpus(argv[i], cpus, cpu_count))
+				cmd_err = false;
+			continue;
+		}
+
+		if (!strcmp(argv[i], argRtPriority)) {
+			if (++i < argc && !rt_priority) {
+				const int lo = sched_get_priority_min(SCHED_FIFO);
+				const int hi = sched_get_priority_max(SCHED_FIFO);
+				int prio = 0;
+
+				if (1 == sscanf(argv[i], "%d", &prio) && 0 < prio && lo <= prio && hi >= prio) {
+					rt_priority = uint32_t(prio);
+					cmd_err = false;
+				}
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argIrq)) {
+			if (++i < argc && !(flags & flag_irq)) {
+				if (1 == sscanf(argv[i], "%u", &irq_cpu) && CPU_SETSIZE > irq_cpu) {
+					flags |= flag_irq;
+					cmd_err = false;
+				}
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argWarmup)) {
+			if (++i < argc && !warmup_frames) {
+				uint32_t count = 0;
+
+				if (1 == sscanf(argv[i], "%u", &count) && count) {
+					warmup_frames = count;
+					cmd_err = false;
+				}
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argSuite)) {
+			if (++i < argc && !(flags & flag_suite)) {
+				if (parse_suite(argv[i], matrix)) {
+					flags |= flag_suite;
+					cmd_err = false;
+				}
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argBaseline) || !strcmp(argv[i], argSave)) {
+			uint32_t& idx = !strcmp(argv[i], argBaseline) ? baseline_idx : save_idx;
+
+			if (++i < argc && !idx) {
+				idx = i;
+				cmd_err = false;
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argQdiscBypass)) {
+			flags |= flag_qdisc_bypass;
+			cmd_err = false;
+			continue;
+		}
+
+		if (!strcmp(argv[i], argSqpoll)) {
+			flags |= flag_sqpoll;
+			cmd_err = false;
+			continue;
+		}
+
+		if (!strcmp(argv[i], argTxLoss)) {
+			flags |= flag_tx_loss;
+			cmd_err = false;
+			continue;
+		}
+
+		if (!strcmp(argv[i], argPayload)) {
+			if (++i < argc && !(flags & flag_payload)) {
+				for (uint32_t j = 0; j < payload_mode_count; ++j) {
+					if (!strcmp(argv[i], payload_name[j])) {
+						payload = j;
+						flags |= flag_payload;
+						cmd_err = false;
+						break;
+					}
+				}
+			}
+			continue;
+		}
+
+		if (!strcmp(argv[i], argVerify)) {
+			flags |= flag_verify;
+			cmd_err = false;
+			continue;
+		}
+
+		if (!strcmp(argv[i], argReflect)) {
+			flags |= flag_reflect;
+			cmd_err = false;
+			continue;
+		}
+
+		if (!strcmp(argv[i], argHugepages)) {
+			flags |= flag_hugepages;
+			cmd_err = false;
+			continue;
+		}
+
+		if (!strcmp(argv[i], argPerf)) {
+			flags |= flag_perf;
+			cmd_err = false;
+			continue;
+		}
+
+		if (!strcmp(argv[i], argTransmitter)) {
+			flags |= flag_transmitter;
+			cmd_err = false;
+			continue;
+		}
+	}
+
+	// ping-pong and full-duplex streaming do not mix, nor does ping-pong take pacing
+	if ((flags & flag_latency) && ((flags & flag_duplex) || 0.0 != rate))
+		cmd_err = true;
+
+	// soak mode streams its own way, timed in user space, and reports at intervals of its own
+	if ((duration && ((flags & (flag_latency | flag_duplex)) || timestamp_none != timestamp)) ||
+		(0.0 != report_interval && !duration))
+		cmd_err = true;
+
+	// the responder learns the rest from the transmitter in the handshake
+	const bool transmitter = 0 != (flags & flag_transmitter);
+	const bool suite = 0 != (flags & flag_suite);
+
+	// reflecting is up to the responder alone, runs and suites up to the transmitter
+	if ((transmitter && (flags & flag_reflect)) || (!transmitter && (runs || warmup_frames || suite || baseline_idx || save_idx)))
+		cmd_err = true;
+
+	// soak mode streams a single run, with no warm-up; the suite sets the engine, frame size, batch and thread count
+	// of each cell itself
+	if (((runs || warmup_frames) && duration) || (!suite && (baseline_idx || save_idx)) ||
+		(suite && ((flags & flag_engine) || batch || threads || size_step || duration)))
+		cmd_err = true;
+
+	// thread counts of the session, or of the cells of the suite
+	uint32_t threads_lo = threads ? threads : 1;
+	uint32_t threads_hi = threads_lo;
+
+	for (uint32_t i = 0; suite && i < matrix.axis[suite_threads].count; ++i) {
+		const uint32_t t = matrix.axis[suite_threads].v[i];
+
+		threads_lo = 0 == i || t < threads_lo ? t : threads_lo;
+		threads_hi = 0 == i || t > threads_hi ? t : threads_hi;
+	}
+
+	// the transmitter fans out to its targets, workers of its own for each; the responder fans in
+	// from as many transmitters as it is told, or given targets
+	if ((transmitter && (peers || threads_hi * target_count > threads_max)) ||
+		(peers && target_count && peers != target_count))
+		cmd_err = true;
+
+	// a priority class takes one worker of each peer at least
+	if (transmitter && pcp_count > threads_lo)
+		cmd_err = true;
+
+	if (cmd_err || !iface_nameidx || (transmitter && (!(flags & flag_target) || !(packet_count || duration)))) {
+		printf("usage: %s %s iface [%s mac[,mac...]|@file] [%s N] [%s N | %s s [%s s]] [%s] [%s socket|ring|mmsg|xdp|uring|udp|tcp] [%s N (1..%zu)] [%s N] [%s N (1..%u)] [%s | %s [%s file]] [%s sw|hw] [%s N | %s min:max:step (%zu..%zu)] [%s N[k|M|G][bps|pps]] [%s ms] [%s text|json|csv] [%s] [%s block|busy|epoll] [%s octets] [%s octets] [%s N] [%s id[:pcp[,pcp...]]] [%s] [%s] [%s] [%s] [%s inc|zeros|prng] [%s] [%s] [%s N (1..%u)] [%s N] [%s default|axis=v[,v...][/axis=...] [%s file] [%s file]] [%s cpu[-cpu][,...]] [%s N] [%s cpu]\n",
+				argv[0],
+				argInterface,
+				argTarget,
+				argPeers,
+				argPacketCount,
+				argDuration,
+				argInterval,
+				argTransmitter,
+				argEngine,
+				argBatch,
+				batch_max,
+				argQueue,
+				argThreads,
+				threads_max,
+				argDuplex,
+				argLatency,
+				argHistogram,
+				argTimestamp,
+				argSize,
+				argSweep,
+				frame_min_size,
+				frame_max_size,
+				argRate,
+				argTimeout,
+				argFormat,
+				argPerf,
+				argPoll,
+				argSndbuf,
+				argRcvbuf,
+				argPriority,
+				argVlan,
+				argQdiscBypass,
+				argTxLoss,
+				argSqpoll,
+				argHugepages,
+				argPayload,
+				argVerify,
+				argReflect,
+				argRuns,
+				runs_max,
+				argWarmup,
+				argSuite,
+				argBaseline,
+				argSave,
+				argCpu,
+				argRtPriority,
+				argIrq);
+		return -1;
+	}
+
+	lock_memory();
+	report out(format);
+
+	session ss;
+	ss.out = &out;
+	ss.iface_name = argv[iface_nameidx];
+	ss.iface_namelen = iface_namelen;
+	ss.target_set = 0 != (flags & flag_target);
+	ss.peer_count = target_count ? target_count : peers ? peers : 1;
+	ss.packet_count = packet_count;
+	ss.engine = engine;
+	ss.batch = batch;
+	ss.queue = queue;
+	ss.threads = threads;
+	ss.transmitter = transmitter;
+	ss.duplex = 0 != (flags & flag_duplex);
+	ss.latency = 0 != (flags & flag_latency);
+	ss.histogram_path = histogram_pathidx ? argv[histogram_pathidx] : 0;
+	ss.pinned = 0 != threads || 0 != cpu_count;
+	memcpy(ss.cpus, cpus, sizeof(cpus));
+	ss.cpu_count = cpu_count;
+	ss.rt_priority = int(rt_priority);
+	ss.irqs = 0;
+	ss.timestamp = int(timestamp);
+	ss.rate = rate;
+	ss.rate_pps = rate_pps;
+	ss.rx_timeout = int(rx_timeout);
+	ss.poll = int(poll);
+	ss.sndbuf = int(sndbuf);
+	ss.rcvbuf = int(rcvbuf);
+	ss.priority = flags & flag_priority ? int(priority) : -1;
+	ss.qdisc_bypass = 0 != (flags & flag_qdisc_bypass);
+	ss.tx_loss = 0 != (flags & flag_tx_loss);
+	ss.sqpoll = 0 != (flags & flag_sqpoll);
+	ss.ipv4 = iface_ipv4(ss.iface_name, ss.iface_namelen);
+	ss.hugepages = 0 != (flags & flag_hugepages);
+	ss.payload = flags & flag_payload ? int(payload) : -1;
+	ss.verify = 0 != (flags & flag_verify);
+	ss.reflect = 0 != (flags & flag_reflect);
+	ss.vlan = 0 != (flags & flag_vlan);
+	ss.vlan_id = vlan_id;
+	ss.pcp_count = pcp_count;
+	memcpy(ss.pcp, pcp, sizeof(pcp));
+	// a session id per peer, all odd, i.e. never 0
+	const uint32_t session_id = (uint32_t(getpid()) << 16 ^ uint32_t(timer_ns())) | 1;
+
+	for (uint32_t k = 0; k < ss.peer_count; ++k) {
+		memcpy(ss.peers[k].mac, target[k], sizeof(ss.peers[k].mac));
+		ss.peers[k].session_id = session_id + 2 * k;
+		ss.peers[k].ipv4 = 0;
+		ss.peers[k].port = 0;
+	}
+
+	crc32c::init();
+	ss.size_min = size_min;
+	ss.size_max = size_max;
+	ss.size_step = size_step;
+	ss.perf = 0 != (flags & flag_perf);
+	ss.perf_user_only = false;
+	ss.perf_mask = ss.perf ? perf_probe(ss.perf_user_only) : 0;
+	ss.duration = duration;
+	ss.report_interval = 0.0 != report_interval ? report_interval : default_report_interval;
+	ss.runs = 0;
+	ss.warmup_runs = 0;
+	ss.warmup_frames = warmup_frames;
+	ss.more = false;
+
+	// the transmitter fills in the defaults and offers the lot; the responder checks whatever it was
+	// given against the offer and adopts the rest
+	if (ss.transmitter) {
+		ss.threads = threads ? threads : 1;
+		ss.batch = batch ? batch : default_batch;
+		ss.runs = runs ? runs : suite ? default_suite_runs : 1;
+		ss.rx_timeout = int(rx_timeout ? rx_timeout : default_rx_timeout);
+		ss.payload = int(payload);
+
+		if (!size_step) {
+			ss.size_min = frame_full_size;
+			ss.size_max = frame_full_size;
+			ss.size_step = 1;
+		}
+	}
+	else
+		fprintf(out.info(), "responder at interface %s, awaiting transmitter\n", ss.iface_name);
+
+	// the irqs of the iface go to the core of choice for as long as bandw runs
+	irq_steering irqs;
+
+	if (flags & flag_irq) {
+		if (!irqs.find(ss.iface_name))
+			fprintf(stderr, "warning: no irqs of interface %s found\n", ss.iface_name);
+		else {
+			irqs.steer(int(irq_cpu));
+			ss.irqs = &irqs;
+		}
+	}
+
+	const bool mode_set = 0 != (flags & (flag_duplex | flag_latency));
+	const bool engine_set = 0 != (flags & flag_engine);
+
+	if (suite)
+		return run_suite(ss, matrix, baseline_idx ? argv[baseline_idx] : 0, save_idx ? argv[save_idx] : 0);
+
+	// the responder stays for as many sessions as the transmitter has in store, each starting afresh
+	const session initial = ss;
+
+	do {
+		ss = initial;
+
+		if (!handshake(ss, mode_set, engine_set))
+			return -1;
+
+		ss.target_set = true;
+		announce(ss);
+
+		const int res = measure(ss, 0);
+
+		if (0 != res)
+			return res;
+	} while (ss.more);
+
 	return 0;
 }
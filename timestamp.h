@@ -0,0 +1,266 @@
+#ifndef timestamp_H__
+#define timestamp_H__
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <linux/net_tstamp.h>
+#include <linux/sockios.h>
+#include <linux/errqueue.h>
+
+// wire-side timestamps via SO_TIMESTAMPING; timestamps of either source come from a clock of their
+// own (CLOCK_REALTIME for software, the NIC's clock for hardware), so only differences between
+// timestamps of the same source are meaningful
+
+enum timestamp_source {
+	timestamp_none,
+	timestamp_sw,   // kernel software timestamps
+	timestamp_hw    // NIC hardware timestamps
+};
+
+static const char* const timestamp_name[] = {
+	"none",
+	"sw",
+	"hw"
+};
+
+// the hardware timestamping config of the iface as found ahead of the first change to it, put back on
+// the way out, SIGINT, SIGTERM and SIGHUP included, as SIOCSHWTSTAMP sets it for the whole device
+class hwtstamp_saved {
+	enum {
+		signal_count = 3
+	};
+
+	char iface[IFNAMSIZ];
+	hwtstamp_config cfg;  // as found
+	bool valid;           // cfg is to be put back
+	bool armed;
+	struct sigaction prev[signal_count]; // actions of the signals ahead of the handler, to pass them on to
+
+	static int signal_of(const size_t i) {
+		static const int sig[signal_count] = { SIGINT, SIGTERM, SIGHUP };
+		return sig[i];
+	}
+
+	// put the config back, then have the signal go on as it would have without the handler
+	static void on_signal(const int sig) {
+		hwtstamp_saved& s = instance();
+
+		s.restore(false);
+
+		for (size_t i = 0; i < signal_count; ++i) {
+			if (signal_of(i) == sig && SIG_DFL != s.prev[i].sa_handler && SIG_IGN != s.prev[i].sa_handler) {
+				s.prev[i].sa_handler(sig);
+				return;
+			}
+		}
+
+		signal(sig, SIG_DFL);
+		raise(sig);
+	}
+
+	hwtstamp_saved()
+	: valid(false)
+	, armed(false) {
+		iface[0] = '\0';
+	}
+
+public:
+	static hwtstamp_saved& instance() {
+		static hwtstamp_saved saved;
+		return saved;
+	}
+
+	~hwtstamp_saved() {
+		restore();
+	}
+
+	// read the config of the iface ahead of changing it, unless read already; false if it cannot be
+	bool save(
+		const int fd,                 // socket to issue the ioctl on
+		const char* const iface_name, // iface name, cstr
+		const size_t iface_namelen) { // iface name length, shorter than IFNAMSIZ
+
+		if (valid)
+			return true;
+
+		ifreq ifr;
+		memset(&ifr, 0, sizeof(ifr));
+		memcpy(ifr.ifr_name, iface_name, iface_namelen);
+		ifr.ifr_data = reinterpret_cast< char* >(&cfg);
+		memset(&cfg, 0, sizeof(cfg));
+
+		if (-1 == ioctl(fd, SIOCGHWTSTAMP, &ifr))
+			return false;
+
+		memcpy(iface, ifr.ifr_name, sizeof(iface));
+		valid = true;
+
+		if (!armed) {
+			struct sigaction sa;
+			memset(&sa, 0, sizeof(sa));
+			sa.sa_handler = on_signal;
+			sigemptyset(&sa.sa_mask);
+
+			for (size_t i = 0; i < signal_count; ++i)
+				sigaction(signal_of(i), &sa, prev + i);
+
+			armed = true;
+		}
+
+		return true;
+	}
+
+	// put the config of old back, warning if it will not go back unless quiet, as in the signal handler
+	void restore(const bool report = true) {
+		if (!valid)
+			return;
+
+		const int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+
+		ifreq ifr;
+		memset(&ifr, 0, sizeof(ifr));
+		memcpy(ifr.ifr_name, iface, sizeof(iface));
+		ifr.ifr_data = reinterpret_cast< char* >(&cfg);
+
+		if ((0 > fd || -1 == ioctl(fd, SIOCSHWTSTAMP, &ifr)) && report)
+			fprintf(stderr, "warning: cannot restore the hardware timestamping config of iface %s (errno: %s)\n", iface, strerror(errno));
+
+		if (0 <= fd)
+			close(fd);
+
+		valid = false;
+	}
+};
+
+// turn on timestamping of incoming, and optionally outgoing frames on the socket; hardware
+// timestamping requires the NIC to go along, failing that fall back to software timestamping;
+// return the source in effect, -1 on error
+static int enable_timestamping(
+	const int fd,                 // file descriptor
+	const char* const iface_name, // iface name, cstr
+	const size_t iface_namelen,   // iface name length, shorter than IFNAMSIZ
+	const int source,             // requested timestamp source
+	const bool tx) {              // timestamp outgoing frames as well; those have to be fetched from the error queue
+
+	int effective = source;
+
+	if (timestamp_hw == source) {
+		hwtstamp_config hwcfg;
+		memset(&hwcfg, 0, sizeof(hwcfg));
+		hwcfg.tx_type = tx ? HWTSTAMP_TX_ON : HWTSTAMP_TX_OFF;
+		hwcfg.rx_filter = HWTSTAMP_FILTER_ALL;
+
+		ifreq ifr;
+		memset(&ifr, 0, sizeof(ifr));
+		memcpy(ifr.ifr_name, iface_name, iface_namelen);
+		ifr.ifr_data = reinterpret_cast< char* >(&hwcfg);
+
+		// the config is to be put back when done; a driver not telling it keeps what is set here
+		static bool warned = false;
+		const bool saved = hwtstamp_saved::instance().save(fd, iface_name, iface_namelen);
+
+		if (-1 == ioctl(fd, SIOCSHWTSTAMP, &ifr)) {
+			fprintf(stderr, "warning: no hardware timestamping on iface (errno: %s), falling back to software\n", strerror(errno));
+			effective = timestamp_sw;
+		}
+		else if (!saved && !warned) {
+			fprintf(stderr, "warning: cannot obtain the hardware timestamping config of iface, it stays as set after bandw exits\n");
+			warned = true;
+		}
+	}
+
+	int flags = SOF_TIMESTAMPING_OPT_TSONLY;
+
+	if (timestamp_hw == effective)
+		flags |= SOF_TIMESTAMPING_RAW_HARDWARE | SOF_TIMESTAMPING_RX_HARDWARE | (tx ? SOF_TIMESTAMPING_TX_HARDWARE : 0);
+	else
+		flags |= SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_RX_SOFTWARE | (tx ? SOF_TIMESTAMPING_TX_SOFTWARE : 0);
+
+	if (0 > setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags))) {
+		fprintf(stderr, "error: cannot enable timestamping (errno: %s)\n", strerror(errno));
+		return -1;
+	}
+
+	return effective;
+}
+
+// room for the control messages accompanying a timestamped frame
+static const size_t timestamp_control_size = 256;
+
+// how long to wait for a tx timestamp to show up on the error queue, ms
+static const int timestamp_wait_ms = 10;
+
+// extract the timestamp of the specified source from the control messages of a received frame
+static bool cmsg_timestamp(
+	msghdr& msg,
+	const int source,
+	uint64_t& ns) {
+
+	for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); 0 != cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		if (SOL_SOCKET != cmsg->cmsg_level || SCM_TIMESTAMPING != cmsg->cmsg_type)
+			continue;
+
+		// ts[0] is the software timestamp, ts[2] the raw hardware one
+		timespec ts[3];
+		memcpy(ts, CMSG_DATA(cmsg), sizeof(ts));
+
+		const timespec& t = ts[timestamp_hw == source ? 2 : 0];
+
+		if (0 == t.tv_sec && 0 == t.tv_nsec)
+			return false;
+
+		ns = 1000000000ULL * t.tv_sec + t.tv_nsec;
+		return true;
+	}
+
+	return false;
+}
+
+// fetch the timestamp of the last frame sent from the error queue, waiting for it up to timeout
+static bool errqueue_timestamp(
+	const int fd,
+	const int source,
+	uint64_t& ns,
+	const int timeout_ms) {
+
+	bool found = false;
+
+	for (;;) {
+		uint64_t control[timestamp_control_size / sizeof(uint64_t)]; // aligned for cmsghdr
+		msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+
+		if (0 > recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT)) {
+			if (EINTR == errno)
+				continue;
+
+			// queue drained - the most recent timestamp wins, if we have not got one, wait a bit
+			if (found || (EAGAIN != errno && EWOULDBLOCK != errno))
+				return found;
+
+			pollfd pfd;
+			pfd.fd = fd;
+			pfd.events = POLLERR;
+			pfd.revents = 0;
+
+			if (0 >= poll(&pfd, 1, timeout_ms))
+				return false;
+
+			continue;
+		}
+
+		found = cmsg_timestamp(msg, source, ns) || found;
+	}
+}
+
+#endif // timestamp_H__
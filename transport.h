@@ -0,0 +1,123 @@
+#ifndef transport_H__
+#define transport_H__
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include "engine.h"
+
+// transport engines: the frames of the test go through the ip stack rather than around it, as udp
+// datagrams or as records of a tcp stream, for the sake of comparison with the raw engines. What
+// goes over the wire is the frame past its eth header, i.e. the test header and the body; incoming
+// frames get the eth header of a frame from the peer put back ahead of them, so the loops see the
+// same frames whichever way they came. The addresses are those of the test ifaces, exchanged in the
+// handshake, a port per worker from a base the ends advertise per peer
+
+// first port of the workers of a session; the worker of index i on the port base + i
+static const uint16_t transport_port_base = 47800;
+
+// ms to set up a connection in, on top of the rx timeout, at the start of a run
+static const int transport_connect_ms = 5000;
+
+// the ipv4 address of the iface, network order; 0 if it has none
+static uint32_t iface_ipv4(
+	const char* const iface_name, // iface name, cstr
+	const size_t iface_namelen) { // iface name length, shorter than IFNAMSIZ
+
+	const int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+
+	if (0 > fd)
+		return 0;
+
+	ifreq ifr;
+	memset(&ifr, 0, sizeof(ifr));
+	memcpy(ifr.ifr_name, iface_name, iface_namelen);
+	ifr.ifr_addr.sa_family = AF_INET;
+
+	const int res = ioctl(fd, SIOCGIFADDR, &ifr);
+	close(fd);
+
+	if (0 > res)
+		return 0;
+
+	return reinterpret_cast< const sockaddr_in* >(&ifr.ifr_addr)->sin_addr.s_addr;
+}
+
+static sockaddr_in transport_addr(
+	const uint32_t ip,     // network order
+	const uint16_t port) { // host order
+
+	sockaddr_in a;
+	memset(&a, 0, sizeof(a));
+	a.sin_family = AF_INET;
+	a.sin_addr.s_addr = ip;
+	a.sin_port = htons(port);
+	return a;
+}
+
+// open an ip socket of the specified type, bound to the local address of the config and the
+// specified port, 0 for any, with the socket options asked for; -1 on error
+static int transport_socket(
+	const engine_config& cfg,
+	const int type,          // SOCK_DGRAM or SOCK_STREAM
+	const uint16_t port,
+	const char* const name) { // engine name, for the errors
+
+	if (0 == cfg.local_ip || 0 == cfg.peer_ip) {
+		fprintf(stderr, "error: %s engine: no ipv4 address on the iface of %s end\n", name, 0 == cfg.local_ip ? "this" : "the peer's");
+		return -1;
+	}
+
+	const int fd = socket(AF_INET, type | SOCK_CLOEXEC, 0);
+
+	if (0 > fd) {
+		fprintf(stderr, "error: cannot create %s socket (errno: %s)\n", name, strerror(errno));
+		return -1;
+	}
+
+	const int on = 1;
+	const sockaddr_in local = transport_addr(cfg.local_ip, port);
+
+	if (0 > setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) ||
+		0 > bind(fd, reinterpret_cast< const sockaddr* >(&local), sizeof(local))) {
+		fprintf(stderr, "error: cannot bind %s socket to port %u (errno: %s)\n", name, unsigned(port), strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	// as on the packet sockets, the forcing variants first, for sizes past the sysctl limits
+	if ((0 != cfg.sndbuf &&
+			0 > setsockopt(fd, SOL_SOCKET, SO_SNDBUFFORCE, &cfg.sndbuf, sizeof(cfg.sndbuf)) &&
+			0 > setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &cfg.sndbuf, sizeof(cfg.sndbuf))) ||
+		(0 != cfg.rcvbuf &&
+			0 > setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &cfg.rcvbuf, sizeof(cfg.rcvbuf)) &&
+			0 > setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &cfg.rcvbuf, sizeof(cfg.rcvbuf))) ||
+		(0 <= cfg.priority &&
+			0 > setsockopt(fd, SOL_SOCKET, SO_PRIORITY, &cfg.priority, sizeof(cfg.priority)))) {
+		fprintf(stderr, "error: cannot set %s socket options (errno: %s)\n", name, strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+// the eth header of the frames from the peer: that of the template outgoing frame, the mac
+// addresses the other way round
+static void transport_rx_header(
+	const engine_config& cfg,
+	uint8_t* const frame) {
+
+	memcpy(frame, cfg.frame_tx + ETH_ALEN, ETH_ALEN);
+	memcpy(frame + ETH_ALEN, cfg.frame_tx, ETH_ALEN);
+	memcpy(frame + 2 * ETH_ALEN, cfg.frame_tx + 2 * ETH_ALEN, ETH_HLEN - 2 * ETH_ALEN);
+}
+
+#endif // transport_H__
@@ -0,0 +1,155 @@
+#ifndef wire_H__
+#define wire_H__
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <endian.h>
+
+// test header, right past the eth header of every test frame; all fields in network order, so peers
+// of either endianness get along; header fields other than the sequence number and timestamp are
+// the same for all frames of a worker and go into the template frame once
+struct __attribute__ ((packed)) wire_header {
+	uint32_t magic;
+	uint8_t version;
+	uint8_t flags;       // wire_flags
+	uint16_t length;     // frame length, eth header included
+	uint8_t worker;      // index of the transmitter's worker the frame belongs to; keyed on by the fanout demux
+	uint8_t reserved[3];
+	uint32_t session;    // session id, picked by the transmitter
+	uint64_t seq;        // sequence number
+	uint64_t timestamp;  // transmitter's time of sending, ns; latency mode
+};
+
+static const uint32_t wire_magic = 0x32100123;
+static const uint8_t wire_version = 5;
+
+// local experimental ethertype, IEEE 802 - no stack claims it
+static const uint16_t wire_proto = 0x88b5;
+
+enum wire_flags {
+	wire_flag_response  = 1, // sent by the responder
+	wire_flag_timestamp = 2, // timestamp is valid
+	wire_flag_control   = 4  // control frame, the test header is followed by a wire_hello
+};
+
+// handshake ahead of the measurement: the transmitter offers the session parameters, the responder
+// accepts or rejects them; all fields in network order
+struct __attribute__ ((packed)) wire_hello {
+	uint8_t kind;          // wire_hello_kind
+	uint8_t mode;          // half-duplex, full-duplex or ping-pong
+	uint8_t engine;        // sender's engine, for the record
+	uint8_t threads;       // worker count
+	uint32_t packet_count; // frames in the test sequence
+	uint16_t size_min;     // frame sizes, a sweep from size_min to size_max in steps of size_step
+	uint16_t size_max;
+	uint16_t size_step;
+	uint16_t rate_pps;     // rate is in frames/s
+	uint64_t rate;         // transmit rate, bits/s on the wire or frames/s; 0 for as fast as possible
+	uint32_t rx_timeout;   // ms
+	uint32_t duration;     // soak mode: s to stream for; 0 for a single test sequence
+	uint8_t payload;       // payload mode of the frame bodies
+	uint8_t verify;        // frame bodies carry a CRC32C trailer
+	uint16_t batch;        // engine batch
+	uint16_t runs;         // runs per frame size
+	uint8_t warmup_runs;   // runs per frame size ahead of those, not counted
+	uint8_t more;          // another session follows this one
+	uint32_t warmup_frames; // frames per run ahead of the timed ones, not counted
+	uint32_t ipv4;         // sender's iface address, for the transport engines; 0 if none
+	uint16_t port;         // sender's port of its first worker of the session, a port per worker on
+};
+
+enum wire_hello_kind {
+	wire_hello_offer = 1,
+	wire_hello_accept,
+	wire_hello_reject
+};
+
+// warm-up frames go by a session of their own, the session id with the top bit flipped
+static const uint32_t wire_warmup_session = 0x80000000;
+
+static const size_t wire_worker_offset = offsetof(wire_header, worker);
+
+// fill in the fields common to all frames of a worker
+static void wire_init(
+	uint8_t* const payload,
+	const size_t frame_size,
+	const uint32_t worker,
+	const uint32_t session,
+	const uint8_t flags) {
+
+	wire_header& h = *reinterpret_cast< wire_header* >(payload);
+	memset(&h, 0, sizeof(h));
+
+	h.magic = htobe32(wire_magic);
+	h.version = wire_version;
+	h.flags = flags;
+	h.length = htobe16(uint16_t(frame_size));
+	h.worker = uint8_t(worker);
+	h.session = htobe32(session);
+}
+
+static void wire_set_seq(
+	uint8_t* const payload,
+	const uint64_t seq) {
+
+	reinterpret_cast< wire_header* >(payload)->seq = htobe64(seq);
+}
+
+static void wire_set_session(
+	uint8_t* const payload,
+	const uint32_t session) {
+
+	reinterpret_cast< wire_header* >(payload)->session = htobe32(session);
+}
+
+static void wire_set_timestamp(
+	uint8_t* const payload,
+	const uint64_t timestamp) {
+
+	reinterpret_cast< wire_header* >(payload)->timestamp = htobe64(timestamp);
+}
+
+static void wire_set_flags(
+	uint8_t* const payload,
+	const uint8_t flags) {
+
+	reinterpret_cast< wire_header* >(payload)->flags = flags;
+}
+
+// tell whether the payload carries a test header of this version for a frame of the given length
+static bool wire_valid(
+	const uint8_t* const payload,
+	const size_t frame_size) {
+
+	const wire_header& h = *reinterpret_cast< const wire_header* >(payload);
+
+	return htobe32(wire_magic) == h.magic &&
+		wire_version == h.version &&
+		htobe16(uint16_t(frame_size)) == h.length;
+}
+
+static uint8_t wire_flags_of(
+	const uint8_t* const payload) {
+
+	return reinterpret_cast< const wire_header* >(payload)->flags;
+}
+
+static uint32_t wire_session_of(
+	const uint8_t* const payload) {
+
+	return be32toh(reinterpret_cast< const wire_header* >(payload)->session);
+}
+
+static uint64_t wire_seq_of(
+	const uint8_t* const payload) {
+
+	return be64toh(reinterpret_cast< const wire_header* >(payload)->seq);
+}
+
+static uint64_t wire_timestamp_of(
+	const uint8_t* const payload) {
+
+	return be64toh(reinterpret_cast< const wire_header* >(payload)->timestamp);
+}
+
+#endif // wire_H__